@@ -0,0 +1,103 @@
+// Parallel Digital Shredder - Copy-on-Write Detection
+// btrfs COWs unless nodatacow is set; XFS and ext4 only COW shared extents;
+// zfs and bcachefs always COW
+
+#include <cstdlib>
+#include <cstring>
+#include "cow.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/statvfs.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+CowInfo inspect_cow(const char*, const StorageInfo&) {
+    return CowInfo();
+}
+#else
+// Extents fetched per FIEMAP call
+static const unsigned int FIEMAP_BATCH = 64;
+
+static bool has_shared_extents(int fd) {
+    size_t size = sizeof(struct fiemap) + FIEMAP_BATCH * sizeof(struct fiemap_extent);
+    struct fiemap* map = static_cast<struct fiemap*>(calloc(1, size));
+    if (!map) {
+        return false;
+    }
+
+    bool shared = false;
+    unsigned long long start = 0;
+
+    for (;;) {
+        memset(map, 0, size);
+        map->fm_start = start;
+        map->fm_length = FIEMAP_MAX_OFFSET - start;
+        map->fm_flags = FIEMAP_FLAG_SYNC;
+        map->fm_extent_count = FIEMAP_BATCH;
+
+        if (ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0) {
+            break;
+        }
+
+        bool last = false;
+        for (unsigned int i = 0; i < map->fm_mapped_extents; i++) {
+            const struct fiemap_extent& extent = map->fm_extents[i];
+            if (extent.fe_flags & FIEMAP_EXTENT_SHARED) {
+                shared = true;
+            }
+            if (extent.fe_flags & FIEMAP_EXTENT_LAST) {
+                last = true;
+            }
+            start = extent.fe_logical + extent.fe_length;
+        }
+
+        if (shared || last) {
+            break;
+        }
+    }
+
+    free(map);
+    return shared;
+}
+
+CowInfo inspect_cow(const char* path, const StorageInfo& info) {
+    CowInfo cow;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return cow;
+    }
+
+    cow.shared_extents = has_shared_extents(fd);
+
+    int flags = 0;
+    if (ioctl(fd, FS_IOC_GETFLAGS, &flags) == 0 && (flags & FS_NOCOW_FL)) {
+        cow.nocow = true;
+    }
+
+    struct statvfs fs;
+    if (fstatvfs(fd, &fs) == 0) {
+        cow.free_bytes = static_cast<long>(fs.f_bavail * fs.f_frsize);
+    }
+    close(fd);
+
+    // Shared extents are copied on write everywhere (reflinks, snapshots);
+    // nodatacow only helps for extents this file owns alone
+    if (info.fs_type == "btrfs") {
+        cow.copy_on_write = !cow.nocow || cow.shared_extents;
+    } else if (info.fs_type == "zfs" || info.fs_type == "bcachefs") {
+        cow.copy_on_write = true;
+    } else {
+        cow.copy_on_write = cow.shared_extents;
+    }
+
+    return cow;
+}
+#endif
@@ -0,0 +1,19 @@
+// Parallel Digital Shredder - Copy-on-Write Detection
+// Shared extents (reflinks, snapshots) and per-file COW state
+
+#ifndef COW_H
+#define COW_H
+
+#include "topology.h"
+
+struct CowInfo {
+    bool copy_on_write = false;   // overwrites allocate new extents
+    bool shared_extents = false;  // some extents are also referenced elsewhere
+    bool nocow = false;           // btrfs nodatacow attribute (chattr +C)
+    long free_bytes = -1;         // available to unprivileged writers, -1 = unknown
+};
+
+// Inspect `path` via FIEMAP, inode flags and statvfs
+CowInfo inspect_cow(const char* path, const StorageInfo& info);
+
+#endif // COW_H
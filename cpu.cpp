@@ -0,0 +1,76 @@
+// Parallel Digital Shredder - CPU Dispatch
+// Detection runs once; kernel lookups afterwards are a table index
+
+#include <cstring>
+#include "cpu.h"
+
+using namespace std;
+
+static const char* const ISA_NAMES[] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+IsaLevel detected_isa() {
+    static const IsaLevel level = [] {
+#ifdef HAVE_X86_KERNELS
+        // __builtin_cpu_supports also checks XCR0, so a CPU whose OS does
+        // not save the wide registers is not offered those kernels
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512dq")) {
+            return ISA_AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return ISA_AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return ISA_SSE2;
+        }
+#endif
+        return ISA_SCALAR;
+    }();
+    return level;
+}
+
+bool cpu_has_aes() {
+#ifdef HAVE_X86_KERNELS
+    static const bool has_aes = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("aes") != 0;
+    }();
+    return has_aes;
+#else
+    return false;
+#endif
+}
+
+static IsaLevel& selected_isa() {
+    static IsaLevel level = detected_isa();
+    return level;
+}
+
+IsaLevel active_isa() {
+    return selected_isa();
+}
+
+bool select_isa(IsaLevel level) {
+    if (level > detected_isa()) {
+        return false;
+    }
+    selected_isa() = level;
+    return true;
+}
+
+const char* isa_name(IsaLevel level) {
+    return ISA_NAMES[level];
+}
+
+bool parse_isa(const char* name, IsaLevel& level) {
+    for (int i = 0; i < ISA_COUNT; i++) {
+        if (strcmp(name, ISA_NAMES[i]) == 0) {
+            level = static_cast<IsaLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
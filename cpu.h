@@ -0,0 +1,41 @@
+// Parallel Digital Shredder - CPU Dispatch
+// Instruction-set levels for the fill, random and compare kernels
+
+#ifndef CPU_H
+#define CPU_H
+
+// x86 kernels are built with per-function target attributes, so the binary
+// itself needs no -march flag and runs on any x86-64
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS
+#endif
+
+// Ordered: each level implies the ones before it
+enum IsaLevel {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2,
+    ISA_AVX512,         // F + BW + DQ
+    ISA_COUNT
+};
+
+// Best level the CPU and OS support (CPUID plus enabled register state)
+IsaLevel detected_isa();
+
+// Level every kernel table is indexed by; detected_isa() unless
+// select_isa() chose another one at startup
+IsaLevel active_isa();
+
+// Force `level` for the rest of the process, e.g. to benchmark the
+// narrower kernels. Call before any job starts. False if the CPU lacks it.
+bool select_isa(IsaLevel level);
+
+// AES-NI, which is independent of the vector levels
+bool cpu_has_aes();
+
+const char* isa_name(IsaLevel level);
+
+// "scalar", "sse2", "avx2" or "avx512"
+bool parse_isa(const char* name, IsaLevel& level);
+
+#endif // CPU_H
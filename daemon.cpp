@@ -0,0 +1,409 @@
+// Parallel Digital Shredder - Daemon Mode
+// One poll() loop serves every client; a single executor thread runs the
+// jobs, so OpenMP keeps its worker pool warm from one job to the next
+
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "daemon.h"
+#include "topology.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+using namespace std;
+
+// Finished jobs remembered for STATUS; older ones are forgotten
+static const size_t MAX_FINISHED_JOBS = 1000;
+
+// Longest command accepted; a client sending more is disconnected
+static const size_t MAX_LINE = 4096;
+
+static const size_t MAX_CLIENTS = 64;
+
+// Job table and queue shared by the server loop and the executor
+class Scheduler {
+public:
+    long submit(DaemonJob job) {
+        lock_guard<mutex> guard(lock);
+        job.id = next_id++;
+        job.state = "queued";
+        long id = job.id;
+        jobs[id] = job;
+        wake.notify_one();
+        return id;
+    }
+
+    // Blocks until a job is due; false once stopped
+    bool next(DaemonJob& job) {
+        unique_lock<mutex> guard(lock);
+        for (;;) {
+            if (stopping) {
+                return false;
+            }
+            DaemonJob* best = pick();
+            if (best) {
+                best->state = "running";
+                ++tick;
+                for (const string& disk : best->disks) {
+                    last_served[disk] = tick;
+                }
+                job = *best;
+                return true;
+            }
+            wake.wait(guard);
+        }
+    }
+
+    void finish(long id, bool ok, const string& message) {
+        lock_guard<mutex> guard(lock);
+        DaemonJob& job = jobs[id];
+        job.state = ok ? "done" : "failed";
+        job.message = message;
+        retire(id);
+    }
+
+    // Drops everything still queued; the running job is left to finish
+    void stop() {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        for (auto& entry : jobs) {
+            if (entry.second.state == "queued") {
+                entry.second.state = "dropped";
+            }
+        }
+        wake.notify_all();
+    }
+
+    void status(long id, ostream& out) {
+        lock_guard<mutex> guard(lock);
+        for (const auto& entry : jobs) {
+            const DaemonJob& job = entry.second;
+            if (id > 0 && job.id != id) {
+                continue;
+            }
+            out << job.id << " " << job.state << " " << job.priority << " " << job.path;
+            if (!job.message.empty()) {
+                out << ": " << job.message;
+            }
+            out << "\n";
+        }
+        out << ".\n";
+    }
+
+private:
+    mutex lock;
+    condition_variable wake;
+    map<long, DaemonJob> jobs;
+    map<string, long> last_served;  // disk -> tick of its last job
+    deque<long> finished;
+    long next_id = 1;
+    long tick = 0;
+    bool stopping = false;
+
+    // Highest priority, then the disks served longest ago, then oldest
+    DaemonJob* pick() {
+        DaemonJob* best = NULL;
+        long best_served = 0;
+        for (auto& entry : jobs) {
+            DaemonJob& job = entry.second;
+            if (job.state != "queued") {
+                continue;
+            }
+            // A job is as recent as the most recently served of its disks
+            long job_served = 0;
+            for (const string& disk : job.disks) {
+                auto served = last_served.find(disk);
+                if (served != last_served.end()) {
+                    job_served = max(job_served, served->second);
+                }
+            }
+            if (!best || job.priority > best->priority ||
+                (job.priority == best->priority && job_served < best_served)) {
+                best = &job;
+                best_served = job_served;
+            }
+        }
+        return best;
+    }
+
+    void retire(long id) {
+        finished.push_back(id);
+        while (finished.size() > MAX_FINISHED_JOBS) {
+            jobs.erase(finished.front());
+            finished.pop_front();
+        }
+    }
+};
+
+// Parse "SHRED [key=value | delete]... /path"; the path runs to the end of
+// the line, so it may contain spaces
+static bool parse_shred(const string& args, DaemonJob& job, string& error) {
+    size_t position = 0;
+    while (position < args.size()) {
+        size_t start = args.find_first_not_of(' ', position);
+        if (start == string::npos) {
+            break;
+        }
+        if (args[start] == '/') {
+            job.path = args.substr(start);
+            return true;
+        }
+
+        size_t end = args.find(' ', start);
+        string token = args.substr(start, (end == string::npos) ? string::npos : end - start);
+        position = (end == string::npos) ? args.size() : end;
+
+        if (token == "delete") {
+            job.delete_file = true;
+        } else if (token.compare(0, 9, "priority=") == 0) {
+            job.priority = atoi(token.c_str() + 9);
+        } else if (token.compare(0, 7, "passes=") == 0) {
+            job.passes = atoi(token.c_str() + 7);
+            if (job.passes < 1) {
+                error = "passes must be at least 1";
+                return false;
+            }
+        } else if (token.compare(0, 8, "profile=") == 0) {
+            job.profile = token.substr(8);
+        } else {
+            error = "unknown option " + token;
+            return false;
+        }
+    }
+    error = "expected an absolute path";
+    return false;
+}
+
+#ifdef _WIN32
+bool run_daemon(const char*, const JobRunner&) {
+    cerr << "Error: Daemon mode is not supported on this platform\n";
+    return false;
+}
+#else
+// Written by the signal handler to wake the poll loop
+static int wake_pipe[2] = { -1, -1 };
+
+static void on_shutdown_signal(int) {
+    char byte = 0;
+    ssize_t ignored = write(wake_pipe[1], &byte, 1);
+    (void)ignored;
+}
+
+static void send_reply(int fd, const string& reply) {
+    size_t sent = 0;
+    while (sent < reply.size()) {
+        ssize_t count = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return;
+        }
+        sent += count;
+    }
+}
+
+// Returns the reply; sets `shutdown` on SHUTDOWN
+static string handle_command(const string& line, Scheduler& scheduler, bool& shutdown) {
+    size_t space = line.find(' ');
+    string command = line.substr(0, space);
+    string args = (space == string::npos) ? "" : line.substr(space + 1);
+
+    if (command == "SHRED") {
+        DaemonJob job;
+        string error;
+        if (!parse_shred(args, job, error)) {
+            return "ERR " + error + "\n";
+        }
+        struct stat st;
+        if (stat(job.path.c_str(), &st) != 0) {
+            return "ERR " + job.path + ": " + strerror(errno) + "\n";
+        }
+        job.disks = backing_disks(job.path.c_str());
+        return "OK " + to_string(scheduler.submit(job)) + "\n";
+    }
+    if (command == "STATUS") {
+        ostringstream out;
+        scheduler.status(args.empty() ? 0 : atol(args.c_str()), out);
+        return out.str();
+    }
+    if (command == "SHUTDOWN") {
+        shutdown = true;
+        return "OK\n";
+    }
+    return "ERR unknown command\n";
+}
+
+// Refuses to replace a socket another daemon still answers on
+static int open_listener(const char* socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        cerr << "Error: Socket path too long: " << socket_path << "\n";
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        cerr << "Error: Cannot create socket: " << strerror(errno) << "\n";
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0) {
+        cerr << "Error: A daemon is already listening on " << socket_path << "\n";
+        close(fd);
+        return -1;
+    }
+    unlink(socket_path);
+
+    // Only the owner may submit jobs
+    mode_t old_mask = umask(0077);
+    int bound = ::bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    umask(old_mask);
+    if (bound != 0 || listen(fd, 16) != 0) {
+        cerr << "Error: Cannot listen on " << socket_path << ": " << strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool run_daemon(const char* socket_path, const JobRunner& runner) {
+    int listen_fd = open_listener(socket_path);
+    if (listen_fd < 0) {
+        return false;
+    }
+    if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        cerr << "Error: Cannot create wake pipe\n";
+        close(listen_fd);
+        unlink(socket_path);
+        return false;
+    }
+
+    struct sigaction action, old_int, old_term;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+
+    Scheduler scheduler;
+    thread executor([&scheduler, &runner] {
+        DaemonJob job;
+        while (scheduler.next(job)) {
+            string message;
+            bool ok = runner(job, message);
+            scheduler.finish(job.id, ok, message);
+        }
+    });
+
+    cout << "Daemon listening on " << socket_path << "\n" << flush;
+
+    struct Client {
+        int fd;
+        string input;
+    };
+    vector<Client> clients;
+    bool shutdown = false;
+
+    while (!shutdown) {
+        vector<struct pollfd> fds;
+        fds.push_back({ wake_pipe[0], POLLIN, 0 });
+        fds.push_back({ listen_fd, POLLIN, 0 });
+        for (const Client& client : clients) {
+            fds.push_back({ client.fd, POLLIN, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Error: poll failed: " << strerror(errno) << "\n";
+            break;
+        }
+
+        if (fds[0].revents) {
+            shutdown = true;
+        }
+
+        // Clients first: fds[] indexes match `clients` before any accept
+        for (size_t i = clients.size(); i-- > 0;) {
+            if (!fds[i + 2].revents) {
+                continue;
+            }
+            Client& client = clients[i];
+            char buffer[1024];
+            ssize_t count = read(client.fd, buffer, sizeof(buffer));
+            bool keep = count > 0;
+            if (keep) {
+                client.input.append(buffer, count);
+            }
+
+            size_t newline;
+            while (keep && (newline = client.input.find('\n')) != string::npos) {
+                string line = client.input.substr(0, newline);
+                client.input.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (!line.empty()) {
+                    send_reply(client.fd, handle_command(line, scheduler, shutdown));
+                }
+            }
+            if (client.input.size() > MAX_LINE) {
+                send_reply(client.fd, "ERR line too long\n");
+                keep = false;
+            }
+
+            if (!keep) {
+                close(client.fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0 && clients.size() < MAX_CLIENTS) {
+                clients.push_back(Client{ fd, "" });
+            } else if (fd >= 0) {
+                send_reply(fd, "ERR too many clients\n");
+                close(fd);
+            }
+        }
+    }
+
+    for (const Client& client : clients) {
+        close(client.fd);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+
+    cout << "Daemon stopping after the running job\n" << flush;
+    scheduler.stop();
+    executor.join();
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    return true;
+}
+#endif
@@ -0,0 +1,43 @@
+// Parallel Digital Shredder - Daemon Mode
+// Long-running service that accepts shred jobs over a Unix domain socket
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct DaemonJob {
+    long id = 0;
+    std::string path;
+    int priority = 0;               // higher runs first
+    int passes = 0;                 // 0 = daemon default
+    std::string profile;            // empty = daemon default
+    bool delete_file = false;
+    std::vector<std::string> disks; // backing_disks(), for fair sharing between devices
+    std::string state = "queued";   // queued, running, done, failed, dropped
+    std::string message;
+};
+
+// Runs one job to completion on the daemon's executor thread. Returns
+// false with `message` set when the job fails.
+typedef std::function<bool(const DaemonJob& job, std::string& message)> JobRunner;
+
+// Serves `socket_path` (created mode 0600) until a SHUTDOWN command,
+// SIGINT or SIGTERM. Jobs run one at a time, so every job gets all the
+// workers. One command per line:
+//
+//   SHRED [priority=N] [passes=N] [profile=NAME] [delete] /absolute/path
+//       -> "OK <id>" or "ERR <reason>"; profile=crypto-erase implies delete
+//   STATUS [id]
+//       -> "<id> <state> <priority> <path>[: <message>]" per job, then "."
+//   SHUTDOWN
+//       -> "OK"; the running job finishes, queued jobs are dropped
+//
+// The highest priority runs first. Among equal priorities, the job whose
+// backing disks were served longest ago goes next, so one busy disk
+// cannot starve the others; partitions and LVs of one disk count as it. Returns false if the socket cannot be set up.
+bool run_daemon(const char* socket_path, const JobRunner& runner);
+
+#endif // DAEMON_H
@@ -0,0 +1,193 @@
+// Parallel Digital Shredder - Delete Pipeline
+// Metadata work runs on its own thread while the next file is being shredded
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <sys/stat.h>
+#include "delete.h"
+#include "histogram.h"
+#include "keystream.h"
+#include "shredder.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Attempts before a colliding random name gives up on obfuscation
+static const int RENAME_ATTEMPTS = 8;
+
+static const char NAME_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+static string parent_dir(const string& path) {
+    size_t slash = path.find_last_of("/\\");
+    if (slash == string::npos) {
+        return ".";
+    }
+    return (slash == 0) ? path.substr(0, 1) : path.substr(0, slash);
+}
+
+// Same-length name so the old name is overwritten in the directory block
+static bool rename_random(const string& path, string& renamed) {
+    size_t slash = path.find_last_of("/\\");
+    size_t base = (slash == string::npos) ? 0 : slash + 1;
+    size_t length = path.size() - base;
+    if (length == 0) {
+        return false;
+    }
+
+    // Straight from the CSPRNG: the job keystream's key may be replaced or
+    // wiped by the main thread while this thread runs
+    vector<unsigned char> noise(length);
+    for (int attempt = 0; attempt < RENAME_ATTEMPTS; attempt++) {
+        system_random(noise.data(), length);
+        renamed = path.substr(0, base);
+        for (unsigned char c : noise) {
+            renamed += NAME_CHARS[c % (sizeof(NAME_CHARS) - 1)];
+        }
+
+        struct stat st;
+        if (stat(renamed.c_str(), &st) != 0 && errno == ENOENT &&
+            rename(path.c_str(), renamed.c_str()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DeletePipeline::DeletePipeline(bool obfuscate, JobStats* stats, int fsync_batch)
+    : obfuscate(obfuscate),
+      stats(stats),
+      fsync_batch(fsync_batch) {
+    worker = thread(&DeletePipeline::run, this);
+}
+
+DeletePipeline::~DeletePipeline() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void DeletePipeline::submit(const string& path, long file_size, bool discard) {
+    {
+        lock_guard<mutex> guard(lock);
+        queue.push_back(Job{ path, file_size, discard });
+    }
+    wake.notify_one();
+}
+
+vector<string> DeletePipeline::finish() {
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [this] { return queue.empty() && !busy; });
+    vector<string> result;
+    result.swap(failed);
+    return result;
+}
+
+int DeletePipeline::deleted_count() {
+    lock_guard<mutex> guard(lock);
+    return deleted;
+}
+
+double DeletePipeline::delete_seconds(const string& path) {
+    lock_guard<mutex> guard(lock);
+    auto found = durations.find(path);
+    return (found != durations.end()) ? found->second : -1.0;
+}
+
+void DeletePipeline::run() {
+    for (;;) {
+        Job job;
+        {
+            unique_lock<mutex> guard(lock);
+            if (queue.empty()) {
+                busy = false;
+                idle.notify_all();
+                wake.wait(guard, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+            }
+            job = queue.front();
+            queue.pop_front();
+            busy = true;
+        }
+
+        auto start = chrono::steady_clock::now();
+        bool ok = delete_one(job);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        bool drained;
+        {
+            lock_guard<mutex> guard(lock);
+            if (ok) {
+                deleted++;
+                durations[job.path] = seconds;
+            } else {
+                failed.push_back(job.path);
+            }
+            drained = queue.empty();
+        }
+
+        // Sync once the batch is full or the queue runs dry, so the last
+        // deletion is durable by the time finish() returns
+        if (unsynced_files >= fsync_batch || drained) {
+            sync_dirs();
+        }
+    }
+}
+
+bool DeletePipeline::delete_one(const Job& job) {
+    string path = job.path;
+
+    if (job.discard) {
+        auto trim_start = chrono::steady_clock::now();
+        trim_file(path.c_str(), job.file_size);
+        if (stats) {
+            stats->deleter().stages[STAGE_TRIM].record(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - trim_start).count());
+        }
+    }
+
+    string renamed;
+    if (obfuscate && rename_random(path, renamed)) {
+        path = renamed;
+    }
+
+#ifndef _WIN32
+    // Release the extents while the inode is still reachable, so the
+    // size and block map do not survive in the freed inode
+    if (truncate(path.c_str(), 0) != 0 && errno == ENOENT) {
+        return false;
+    }
+#endif
+
+    if (remove(path.c_str()) != 0) {
+        return false;
+    }
+
+    dirty_dirs.insert(parent_dir(path));
+    unsynced_files++;
+    return true;
+}
+
+void DeletePipeline::sync_dirs() {
+#ifndef _WIN32
+    for (const string& dir : dirty_dirs) {
+        int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+#endif
+    dirty_dirs.clear();
+    unsynced_files = 0;
+}
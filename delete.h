@@ -0,0 +1,68 @@
+// Parallel Digital Shredder - Delete Pipeline
+// Background worker that scrubs metadata and unlinks shredded files
+
+#ifndef DELETE_H
+#define DELETE_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class JobStats;
+
+class DeletePipeline {
+public:
+    // With `obfuscate`, each file is renamed to a random name of the same
+    // length before it is truncated and unlinked. Directory entries are made
+    // durable with one fsync per directory every `fsync_batch` files.
+    // Discard latencies go to the deleter slot of `stats` when given.
+    explicit DeletePipeline(bool obfuscate, JobStats* stats = nullptr, int fsync_batch = 64);
+    ~DeletePipeline();
+
+    // Queue a shredded file; `discard` punches out its blocks first
+    void submit(const std::string& path, long file_size, bool discard);
+
+    // Wait until every queued file is gone and its directory synced.
+    // Returns the paths that could not be deleted.
+    std::vector<std::string> finish();
+
+    int deleted_count();
+
+    // Time spent deleting `path` (discard, rename, truncate, unlink), or
+    // -1 if it was not deleted. Batched directory syncs are not included.
+    double delete_seconds(const std::string& path);
+
+private:
+    struct Job {
+        std::string path;
+        long file_size;
+        bool discard;
+    };
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Job> queue;
+    bool busy = false;
+    bool stopping = false;
+    bool obfuscate;
+    JobStats* stats;
+    int fsync_batch;
+    int unsynced_files = 0;
+    int deleted = 0;
+    std::set<std::string> dirty_dirs;
+    std::vector<std::string> failed;
+    std::map<std::string, double> durations;
+    std::thread worker;
+
+    void run();
+    bool delete_one(const Job& job);
+    void sync_dirs();
+};
+
+#endif // DELETE_H
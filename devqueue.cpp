@@ -0,0 +1,116 @@
+// Parallel Digital Shredder - Device Queues
+// One std::thread per slot; each runs its own OpenMP teams, so the slots
+// of different devices never wait on each other
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "devqueue.h"
+#include "topology.h"
+
+using namespace std;
+
+static bool shares_disk(const vector<string>& a, const vector<string>& b) {
+    for (const string& disk : a) {
+        if (find(b.begin(), b.end(), disk) != b.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_disks(vector<string>& disks, const vector<string>& more) {
+    for (const string& disk : more) {
+        if (find(disks.begin(), disks.end(), disk) == disks.end()) {
+            disks.push_back(disk);
+        }
+    }
+}
+
+vector<DeviceQueue> group_by_device(const vector<string>& paths) {
+    vector<DeviceQueue> queues;
+    DeviceQueue missing;
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        vector<string> disks = backing_disks(paths[i].c_str());
+        if (disks.empty()) {
+            missing.items.push_back(i);
+            continue;
+        }
+
+        // A path can join queues that were apart so far (a RAID set over
+        // disks that each had a queue); they become one, in path order
+        size_t target = queues.size();
+        for (size_t q = 0; q < queues.size(); q++) {
+            if (!shares_disk(queues[q].disks, disks)) {
+                continue;
+            }
+            if (target == queues.size()) {
+                target = q;
+                continue;
+            }
+            add_disks(queues[target].disks, queues[q].disks);
+            queues[target].items.insert(queues[target].items.end(),
+                                        queues[q].items.begin(), queues[q].items.end());
+            sort(queues[target].items.begin(), queues[target].items.end());
+            queues.erase(queues.begin() + q);
+            q--;
+        }
+        if (target == queues.size()) {
+            queues.push_back(DeviceQueue());
+        }
+        add_disks(queues[target].disks, disks);
+        queues[target].items.push_back(i);
+    }
+
+    if (!missing.items.empty()) {
+        queues.push_back(missing);
+    }
+    return queues;
+}
+
+static int slots_of(const DeviceQueue& queue) {
+    return min(max(queue.limit, 1), static_cast<int>(queue.items.size()));
+}
+
+int queue_slots(const vector<DeviceQueue>& queues) {
+    int slots = 0;
+    for (const DeviceQueue& queue : queues) {
+        slots += slots_of(queue);
+    }
+    return slots;
+}
+
+void run_device_queues(const vector<DeviceQueue>& queues, int cpu_budget,
+                       const function<void(size_t item, int slot, int cpu_share)>& work) {
+    // Next unclaimed position in each queue
+    unique_ptr<atomic<size_t>[]> next(new atomic<size_t>[queues.size()]);
+    for (size_t q = 0; q < queues.size(); q++) {
+        next[q] = 0;
+    }
+
+    atomic<int> running(queue_slots(queues));
+    vector<thread> workers;
+
+    for (size_t q = 0; q < queues.size(); q++) {
+        for (int i = 0; i < slots_of(queues[q]); i++) {
+            int slot = static_cast<int>(workers.size());
+            workers.push_back(thread([&, q, slot] {
+                const DeviceQueue& own = queues[q];
+                for (;;) {
+                    size_t position = next[q].fetch_add(1);
+                    if (position >= own.items.size()) {
+                        break;
+                    }
+                    work(own.items[position], slot, max(1, cpu_budget / max(running.load(), 1)));
+                }
+                running--;
+            }));
+        }
+    }
+
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
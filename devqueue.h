@@ -0,0 +1,36 @@
+// Parallel Digital Shredder - Device Queues
+// Batch work grouped by backing device, each device with its own limit
+
+#ifndef DEVQUEUE_H
+#define DEVQUEUE_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct DeviceQueue {
+    std::vector<std::string> disks; // backing_disks() of its paths; empty = not found
+    int limit = 1;                  // items of this queue running at once
+    std::vector<size_t> items;      // indexes into the caller's list, in order
+};
+
+// One queue per set of backing disks, in order of first appearance: paths
+// whose disks overlap (two partitions of one disk, an LV on it) share a
+// queue. Paths that cannot be stat'ed share a last queue with no disks so
+// they still get reported.
+std::vector<DeviceQueue> group_by_device(const std::vector<std::string>& paths);
+
+// Items that can be in flight at once: each queue's limit, capped by its
+// number of items
+int queue_slots(const std::vector<DeviceQueue>& queues);
+
+// Runs work(item, slot, cpu_share) for every item of every queue. Queues
+// run in parallel, each with at most `limit` items in flight. `slot`
+// (0 .. queue_slots - 1) is the same for every item run by one thread and
+// never shared by two items at once. `cpu_share` splits `cpu_budget` over
+// the items running when the item starts, so workers move to the remaining
+// devices as the others drain.
+void run_device_queues(const std::vector<DeviceQueue>& queues, int cpu_budget,
+                       const std::function<void(size_t item, int slot, int cpu_share)>& work);
+
+#endif // DEVQUEUE_H
@@ -0,0 +1,672 @@
+// Parallel Digital Shredder - Overwrite Engine
+// All writes are positional (pwrite), so no file position is shared between
+// threads; the pipeline decides which thread writes which range
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "engine.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "numa.h"
+#include "throttle.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+#define O_DIRECT 0
+#define O_CLOEXEC 0
+
+static long pwrite(int fd, const void* buffer, size_t count, long offset) {
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<unsigned long long>(offset) >> 32);
+
+    DWORD written = 0;
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if (!WriteFile(handle, buffer, static_cast<DWORD>(count), &written, &overlapped)) {
+        errno = EIO;
+        return -1;
+    }
+    return written;
+}
+
+static int fdatasync(int fd) {
+    return _commit(fd);
+}
+#endif
+
+// Shared writable mappings need a descriptor opened for reading too
+static int open_for_backend(const char* path, ShredContext& ctx) {
+#ifdef _WIN32
+    ctx.plan.backend = BACKEND_PWRITE;
+#else
+    if (ctx.plan.backend == BACKEND_MMAP) {
+        int fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd >= 0) {
+            return fd;
+        }
+        ctx.plan.backend = BACKEND_PWRITE;
+    }
+#endif
+    return open(path, O_WRONLY | O_CLOEXEC);
+}
+
+// Prefault the whole file in one call instead of one fault per page
+static void map_target(ShredContext& ctx) {
+#ifndef _WIN32
+    if (ctx.plan.backend != BACKEND_MMAP || ctx.file_size <= 0) {
+        ctx.plan.backend = BACKEND_PWRITE;
+        return;
+    }
+
+    void* map = mmap(NULL, ctx.file_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ctx.tail_fd, 0);
+    if (map == MAP_FAILED) {
+        ctx.plan.backend = BACKEND_PWRITE;
+        return;
+    }
+    ctx.map = static_cast<unsigned char*>(map);
+    ctx.plan.direct_io = false;
+#endif
+}
+
+bool open_shred_target(const char* path, const IoPlan& plan,
+                       long logical_block_size, ShredContext& ctx) {
+    ctx.plan = plan;
+    ctx.tail_fd = open_for_backend(path, ctx);
+    if (ctx.tail_fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(ctx.tail_fd, &st) != 0) {
+        close(ctx.tail_fd);
+        ctx.tail_fd = -1;
+        return false;
+    }
+    ctx.file_size = st.st_size;
+
+    ctx.fd = ctx.tail_fd;
+    ctx.alignment = 1;
+    map_target(ctx);
+    if (ctx.plan.direct_io) {
+        int direct_fd = open(path, O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (direct_fd >= 0 && O_DIRECT != 0) {
+            ctx.fd = direct_fd;
+            ctx.alignment = max(logical_block_size, 4096L);
+        } else {
+            if (direct_fd >= 0) {
+                close(direct_fd);
+            }
+            ctx.plan.direct_io = false;
+        }
+    }
+
+    return true;
+}
+
+void close_shred_target(ShredContext& ctx) {
+#ifndef _WIN32
+    if (ctx.map) {
+        munmap(ctx.map, ctx.file_size);
+        ctx.map = nullptr;
+    }
+#endif
+    if (ctx.fd >= 0 && ctx.fd != ctx.tail_fd) {
+        close(ctx.fd);
+    }
+    if (ctx.tail_fd >= 0) {
+        close(ctx.tail_fd);
+    }
+    ctx.fd = -1;
+    ctx.tail_fd = -1;
+}
+
+// Charge the time since `start` to `stage` in the calling worker's slot
+static void record_stage(ShredContext& ctx, Stage stage, chrono::steady_clock::time_point start) {
+    int slot = ctx.worker_base + omp_get_thread_num();
+    if (ctx.stats && slot < ctx.stats->worker_slots()) {
+        ctx.stats->worker(slot).stages[stage].record(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+}
+
+static void count_written(ShredContext& ctx, long bytes) {
+    ctx.bytes_written += bytes;
+    if (ctx.progress) {
+        ctx.progress->bytes_written += bytes;
+    }
+}
+
+// Pins the calling worker to its planned CPU for one parallel region and
+// restores its previous affinity afterwards, so threads that outlive the
+// pass (the caller, the OpenMP pool) start the next job unpinned
+class WorkerPin {
+public:
+    explicit WorkerPin(const ShredContext& ctx) {
+        if (!ctx.worker_cpus.empty()) {
+            pinned = pin_current_thread(ctx.worker_cpus[omp_get_thread_num()], &saved);
+        }
+    }
+
+    ~WorkerPin() {
+        if (pinned) {
+            restore_thread_affinity(saved);
+        }
+    }
+
+private:
+    ThreadAffinity saved;
+    bool pinned = false;
+};
+
+// Attempts per write before a transient error is given up on; the backoff
+// doubles from 1 ms, so a write waits at most 127 ms in total
+static const int MAX_WRITE_ATTEMPTS = 8;
+
+// Units allowed to fail in one pass before the workers give up on it
+static const size_t MAX_FAILED_RANGES = 64;
+
+static bool is_transient(int error) {
+    return error == EINTR || error == EAGAIN || error == EWOULDBLOCK ||
+           error == ENOMEM || error == ENOBUFS;
+}
+
+static void record_failure(ShredContext& ctx, long offset, long length, int error,
+                           const char* stage) {
+    lock_guard<mutex> guard(ctx.failed_lock);
+    ctx.failed_ranges.push_back({offset, length, error, stage});
+}
+
+// Write [offset, offset + length) from `buffer`. Direct writes must start and
+// end on the alignment, so a span crossing the last full block is split and
+// the partial block goes through the buffered descriptor. A span that
+// starts unaligned (a range left by an earlier short write) is written
+// buffered, and so is the rest of a span once a short write misaligns it.
+static bool write_span(ShredContext& ctx, const unsigned char* buffer, long offset, long length) {
+    const long direct_end = ctx.file_size - ctx.file_size % ctx.alignment;
+    bool direct_ok = (offset % ctx.alignment == 0);
+    int attempts = 0;
+
+    while (length > 0) {
+        int fd = ctx.fd;
+        long bytes_to_write = length;
+        if (offset >= direct_end || !direct_ok) {
+            fd = ctx.tail_fd;
+        } else if (offset + bytes_to_write > direct_end) {
+            bytes_to_write = direct_end - offset;
+        }
+
+        if (ctx.limiter && attempts == 0) {
+            auto wait_start = chrono::steady_clock::now();
+            ctx.limiter->acquire(bytes_to_write);
+            record_stage(ctx, STAGE_WAIT, wait_start);
+        }
+
+        auto write_start = chrono::steady_clock::now();
+        long written = pwrite(fd, buffer, bytes_to_write, offset);
+        int error = (written < 0) ? errno : EIO;
+        record_stage(ctx, STAGE_WRITE, write_start);
+
+        if (ctx.limiter) {
+            ctx.limiter->record_latency(chrono::duration<double>(
+                chrono::steady_clock::now() - write_start).count());
+        }
+
+        if (written > 0) {
+            buffer += written;
+            offset += written;
+            length -= written;
+            count_written(ctx, written);
+            if (written != bytes_to_write) {
+                ctx.write_retries++;
+                direct_ok = direct_ok && (written % ctx.alignment == 0);
+            }
+            attempts = 0;
+            continue;
+        }
+
+        // Nothing written: retry transient errors with a bounded backoff
+        if ((written == 0 || is_transient(error)) && ++attempts < MAX_WRITE_ATTEMPTS) {
+            ctx.write_retries++;
+            if (error != EINTR) {
+                this_thread::sleep_for(chrono::milliseconds(1L << (attempts - 1)));
+            }
+            continue;
+        }
+
+        record_failure(ctx, offset, length, error, "write");
+        return false;
+    }
+
+    return true;
+}
+
+// Checked before each new unit; records that the pass stopped short
+static bool stop_requested(ShredContext& ctx) {
+    if (ctx.cancel && ctx.cancel->load(memory_order_relaxed)) {
+        ctx.cancelled = true;
+        return true;
+    }
+    return false;
+}
+
+// A failed unit is recorded and skipped so the rest of the pass still gets
+// written; only a pass failing everywhere is worth stopping early
+static bool too_many_failures(ShredContext& ctx) {
+    lock_guard<mutex> guard(ctx.failed_lock);
+    return ctx.failed_ranges.size() > MAX_FAILED_RANGES;
+}
+
+// Rewrite the ranges the workers gave up on, serially and with a fresh
+// buffer; whatever fails again stays in ctx.failed_ranges
+static void retry_failed_ranges(ShredContext& ctx, const PassPattern& pattern, FillKernel fill) {
+    vector<FailedRange> ranges;
+    ranges.swap(ctx.failed_ranges);
+    if (ranges.empty()) {
+        return;
+    }
+
+    unsigned char* buffer = alloc_local_buffer(ctx.plan.unit_size);
+    for (const FailedRange& range : ranges) {
+        if (!buffer) {
+            ctx.failed_ranges.push_back(range);
+            continue;
+        }
+        // Each range lies within one unit, so it fits the buffer
+        ctx.write_retries++;
+        fill(buffer, range.length, range.offset, pattern);
+        write_span(ctx, buffer, range.offset, range.length);
+    }
+    free_local_buffer(buffer, ctx.plan.unit_size);
+}
+
+// PIPELINE_CHUNKED: every thread fills and writes its own contiguous chunk
+static bool run_chunked(ShredContext& ctx, const PassPattern& pattern, FillKernel fill) {
+    const int threads = ctx.plan.threads;
+    const long unit_size = ctx.plan.unit_size;
+    const long direct_end = ctx.file_size - ctx.file_size % ctx.alignment;
+    const long chunk_size = (direct_end / threads) / ctx.alignment * ctx.alignment;
+
+    atomic<bool> failed(false);
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int tid = 0; tid < threads; tid++) {
+        WorkerPin pin(ctx);
+
+        long current_offset = tid * chunk_size;
+        long chunk_end = (tid == threads - 1) ? ctx.file_size : current_offset + chunk_size;
+
+        // Allocated after pinning so pages are node-local; page alignment
+        // also satisfies O_DIRECT
+        unsigned char* buffer = alloc_local_buffer(unit_size);
+        if (!buffer) {
+            failed = true;
+            continue;
+        }
+
+        while (current_offset < chunk_end && !failed && !stop_requested(ctx)) {
+            long bytes_to_write = min(unit_size, chunk_end - current_offset);
+
+            auto fill_start = chrono::steady_clock::now();
+            fill(buffer, bytes_to_write, current_offset, pattern);
+            record_stage(ctx, STAGE_FILL, fill_start);
+
+            if (!write_span(ctx, buffer, current_offset, bytes_to_write) &&
+                too_many_failures(ctx)) {
+                failed = true;
+                break;
+            }
+
+            current_offset += bytes_to_write;
+        }
+
+        free_local_buffer(buffer, unit_size);
+    }
+
+    return !failed;
+}
+
+// Spin briefly, then sleep: generators may wait a long time on a slow disk
+static void wait_backoff(int& spins) {
+    if (++spins < 64) {
+        this_thread::yield();
+    } else {
+        this_thread::sleep_for(chrono::microseconds(50));
+    }
+}
+
+// Lock-free ring of unit buffers between generator and writer threads.
+//
+// Slot i carries units i, i + R, i + 2R, ... Its state is 2u while free for
+// unit u and 2u + 1 once unit u is filled; the writer hands it on to unit
+// u + R by storing 2(u + R). Generators that run R units ahead of the
+// slowest writer block in wait_free(), which is the backpressure.
+struct BufferRing {
+    vector<unsigned char*> slots;
+    vector<atomic<long>> states;
+    const atomic<bool>& failed;
+    const atomic<bool>* cancel;
+
+    BufferRing(int size, const atomic<bool>& failed_flag, const atomic<bool>* cancel_flag)
+        : slots(size, nullptr), states(size), failed(failed_flag), cancel(cancel_flag) {
+        for (int i = 0; i < size; i++) {
+            states[i] = 2L * i;
+        }
+    }
+
+    long size() const {
+        return static_cast<long>(slots.size());
+    }
+
+    // Both waits return NULL if the job failed or was cancelled while waiting
+    unsigned char* wait_free(long unit) {
+        return wait_state(unit, 2 * unit);
+    }
+
+    unsigned char* wait_filled(long unit) {
+        return wait_state(unit, 2 * unit + 1);
+    }
+
+    void publish(long unit) {
+        states[unit % size()].store(2 * unit + 1, memory_order_release);
+    }
+
+    void release(long unit) {
+        states[unit % size()].store(2 * (unit + size()), memory_order_release);
+    }
+
+private:
+    unsigned char* wait_state(long unit, long state) {
+        long slot = unit % size();
+        int spins = 0;
+        while (states[slot].load(memory_order_acquire) != state) {
+            if (failed || (cancel && cancel->load(memory_order_relaxed))) {
+                return NULL;
+            }
+            wait_backoff(spins);
+        }
+        return slots[slot];
+    }
+};
+
+// Single thread fills and writes in file order
+static bool run_single(ShredContext& ctx, const PassPattern& pattern, FillKernel fill) {
+    const long unit_size = ctx.plan.unit_size;
+
+    WorkerPin pin(ctx);
+    unsigned char* buffer = alloc_local_buffer(unit_size);
+    if (!buffer) {
+        return false;
+    }
+
+    bool ok = true;
+    for (long offset = 0; offset < ctx.file_size && ok && !stop_requested(ctx); offset += unit_size) {
+        long length = min(unit_size, ctx.file_size - offset);
+        auto fill_start = chrono::steady_clock::now();
+        fill(buffer, length, offset, pattern);
+        record_stage(ctx, STAGE_FILL, fill_start);
+        ok = write_span(ctx, buffer, offset, length) || !too_many_failures(ctx);
+    }
+
+    free_local_buffer(buffer, unit_size);
+    return ok;
+}
+
+// Constant and periodic patterns have nothing to generate per write. Each
+// writer prepares one buffer per phase (offset % period) up front, then
+// claims units and writes them from the matching buffer.
+static bool run_static(ShredContext& ctx, const PassPattern& pattern, FillKernel fill, int writers) {
+    const long unit_size = ctx.plan.unit_size;
+    const long total_units = (ctx.file_size + unit_size - 1) / unit_size;
+    const int period = pattern.period;
+
+    atomic<long> next_unit(0);
+    atomic<bool> failed(false);
+
+    #pragma omp parallel num_threads(writers)
+    {
+        WorkerPin pin(ctx);
+
+        unsigned char* phase_buffers[MAX_PATTERN_BYTES] = { NULL };
+        for (int phase = 0; phase < period; phase++) {
+            phase_buffers[phase] = alloc_local_buffer(unit_size);
+            if (!phase_buffers[phase]) {
+                failed = true;
+                break;
+            }
+            auto fill_start = chrono::steady_clock::now();
+            fill(phase_buffers[phase], unit_size, phase, pattern);
+            record_stage(ctx, STAGE_FILL, fill_start);
+        }
+
+        for (;;) {
+            long unit = next_unit.fetch_add(1);
+            if (unit >= total_units || failed || stop_requested(ctx)) {
+                break;
+            }
+            long offset = unit * unit_size;
+            if (!write_span(ctx, phase_buffers[offset % period], offset,
+                            min(unit_size, ctx.file_size - offset)) &&
+                too_many_failures(ctx)) {
+                failed = true;
+            }
+        }
+
+        for (int phase = 0; phase < period; phase++) {
+            free_local_buffer(phase_buffers[phase], unit_size);
+        }
+    }
+
+    return !failed;
+}
+
+// Random passes: generator threads fill ring slots while `writers` threads
+// drain them, so pattern generation overlaps the device write instead of
+// alternating with it. Writers claim units in file order; with one writer
+// the file is streamed strictly front to back (PIPELINE_SEQUENTIAL).
+static bool run_pipelined(ShredContext& ctx, const PassPattern& pattern, FillKernel fill, int writers) {
+    const int threads = ctx.plan.threads;
+
+    if (threads < 2) {
+        return run_single(ctx, pattern, fill);
+    }
+    if (writers >= threads) {
+        writers = threads - 1;
+    }
+
+    const long unit_size = ctx.plan.unit_size;
+    const long total_units = (ctx.file_size + unit_size - 1) / unit_size;
+
+    atomic<long> next_fill(0);
+    atomic<long> next_write(0);
+    atomic<bool> failed(false);
+    BufferRing ring(max(ctx.plan.queue_depth, writers + 1), failed, ctx.cancel);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        WorkerPin pin(ctx);
+
+        // Spread first touch of the slots over all pinned threads
+        #pragma omp for schedule(static)
+        for (long i = 0; i < ring.size(); i++) {
+            ring.slots[i] = alloc_local_buffer(unit_size);
+            if (!ring.slots[i]) {
+                failed = true;
+            }
+        }
+
+        if (omp_get_thread_num() < writers) {
+            for (;;) {
+                long unit = next_write.fetch_add(1);
+                if (unit >= total_units || stop_requested(ctx)) {
+                    break;
+                }
+                auto wait_start = chrono::steady_clock::now();
+                unsigned char* buffer = ring.wait_filled(unit);
+                record_stage(ctx, STAGE_WAIT, wait_start);
+                if (!buffer) {
+                    stop_requested(ctx);
+                    break;
+                }
+
+                long offset = unit * unit_size;
+                if (!write_span(ctx, buffer, offset, min(unit_size, ctx.file_size - offset)) &&
+                    too_many_failures(ctx)) {
+                    failed = true;
+                    break;
+                }
+                ring.release(unit);
+            }
+        } else {
+            for (;;) {
+                long unit = next_fill.fetch_add(1);
+                if (unit >= total_units || stop_requested(ctx)) {
+                    break;
+                }
+                auto wait_start = chrono::steady_clock::now();
+                unsigned char* buffer = ring.wait_free(unit);
+                record_stage(ctx, STAGE_WAIT, wait_start);
+                if (!buffer) {
+                    stop_requested(ctx);
+                    break;
+                }
+
+                long offset = unit * unit_size;
+                auto fill_start = chrono::steady_clock::now();
+                fill(buffer, min(unit_size, ctx.file_size - offset), offset, pattern);
+                record_stage(ctx, STAGE_FILL, fill_start);
+                ring.publish(unit);
+            }
+        }
+
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for (long i = 0; i < ring.size(); i++) {
+            free_local_buffer(ring.slots[i], unit_size);
+        }
+    }
+
+    return !failed;
+}
+
+// BACKEND_MMAP: the kernels write straight into the mapped page cache, so
+// there is no staging buffer and no system call until the msync
+static bool run_mapped(ShredContext& ctx, const PassPattern& pattern, FillKernel fill) {
+    const int threads = ctx.plan.threads;
+    const long unit_size = ctx.plan.unit_size;
+    const long total_units = (ctx.file_size + unit_size - 1) / unit_size;
+
+    auto fill_unit = [&](long unit) {
+        // Units cannot leave a parallel for early; skip the rest instead
+        if (stop_requested(ctx)) {
+            return;
+        }
+        long offset = unit * unit_size;
+        long length = min(unit_size, ctx.file_size - offset);
+
+        if (ctx.limiter) {
+            auto wait_start = chrono::steady_clock::now();
+            ctx.limiter->acquire(length);
+            record_stage(ctx, STAGE_WAIT, wait_start);
+        }
+        auto fill_start = chrono::steady_clock::now();
+        fill(ctx.map + offset, length, offset, pattern);
+        record_stage(ctx, STAGE_FILL, fill_start);
+        count_written(ctx, length);
+    };
+
+    if (threads < 2 || total_units < 2) {
+        for (long unit = 0; unit < total_units; unit++) {
+            fill_unit(unit);
+        }
+        return !ctx.cancelled;
+    }
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long unit = 0; unit < total_units; unit++) {
+        fill_unit(unit);
+    }
+
+    return !ctx.cancelled;
+}
+
+bool run_pass(ShredContext& ctx, const PassPattern& pattern) {
+    ctx.failed_ranges.clear();
+    ctx.cancelled = false;
+
+#ifndef _WIN32
+    if (ctx.map) {
+        bool ok = run_mapped(ctx, pattern, stream_kernel_for(pattern.kind));
+        // MS_SYNC writes the dirty pages back before the next pass
+        // overwrites them in memory
+        auto flush_start = chrono::steady_clock::now();
+        if (msync(ctx.map, ctx.file_size, MS_SYNC) != 0) {
+            record_failure(ctx, 0, ctx.file_size, errno, "flush");
+            ok = false;
+        }
+        record_stage(ctx, STAGE_FLUSH, flush_start);
+        return ok;
+    }
+#endif
+
+    FillKernel fill = fill_kernel_for(pattern.kind);
+    bool ok;
+
+    if (ctx.plan.threads < 2) {
+        // Small files: no parallel region at all
+        ok = run_single(ctx, pattern, fill);
+    } else if (pattern.kind != FILL_RANDOM) {
+        // Only the sequential sweep needs writes in file order
+        int writers = (ctx.plan.pipeline == PIPELINE_SEQUENTIAL) ? 1 : ctx.plan.threads;
+        ok = run_static(ctx, pattern, fill, writers);
+    } else {
+        switch (ctx.plan.pipeline) {
+            case PIPELINE_SEQUENTIAL:
+                ok = run_pipelined(ctx, pattern, fill, 1);
+                break;
+            case PIPELINE_OVERLAPPED:
+                ok = run_pipelined(ctx, pattern, fill, ctx.plan.writers);
+                break;
+            default:
+                ok = run_chunked(ctx, pattern, fill);
+                break;
+        }
+    }
+
+    if (ok && !ctx.cancelled) {
+        retry_failed_ranges(ctx, pattern, fill);
+        ok = ctx.failed_ranges.empty();
+    }
+    // What was written before the cancel is still flushed below
+    if (ctx.cancelled) {
+        ok = false;
+    }
+
+    // Without this, buffered passes could be merged in the page cache and
+    // only the last one would ever reach the device. A failed sync is not
+    // retried: the kernel may already have dropped the dirty pages.
+    auto flush_start = chrono::steady_clock::now();
+    if (fdatasync(ctx.tail_fd) != 0) {
+        record_failure(ctx, 0, ctx.file_size, errno, "flush");
+        ok = false;
+    }
+    record_stage(ctx, STAGE_FLUSH, flush_start);
+
+    return ok;
+}
@@ -0,0 +1,65 @@
+// Parallel Digital Shredder - Overwrite Engine
+// Positional writes (pwrite) from OpenMP workers, one call per pass
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "pattern.h"
+#include "strategy.h"
+
+class RateLimiter;
+class JobStats;
+struct JobProgress;
+
+// Part of a pass that could not be written, even after retries
+struct FailedRange {
+    long offset;
+    long length;
+    int error;                      // errno of the last attempt
+    const char* stage;              // "write" or "flush"
+};
+
+struct ShredContext {
+    int fd = -1;                    // O_DIRECT when plan.direct_io
+    int tail_fd = -1;               // buffered, for the unaligned end of the file
+    long file_size = 0;
+    long alignment = 1;             // offset/length granularity of fd
+    unsigned char* map = nullptr;   // whole file, when plan.backend is mmap
+    IoPlan plan;
+    std::vector<int> worker_cpus;   // CPU per worker; empty = unpinned
+    RateLimiter* limiter = nullptr;
+    JobStats* stats = nullptr;      // per-stage latencies; NULL = not recorded
+    int worker_base = 0;            // stats slot of OpenMP thread 0
+    JobProgress* progress = nullptr; // job-wide counters; NULL = not exported
+    const std::atomic<bool>* cancel = nullptr; // set to stop the pass early; NULL = never
+    std::atomic<long> bytes_written{0};
+    std::atomic<long> write_retries{0};     // transient errors and short writes retried
+
+    // Filled by run_pass; empty after a successful pass
+    std::vector<FailedRange> failed_ranges;
+    std::mutex failed_lock;
+    std::atomic<bool> cancelled{false};     // the last pass stopped on `cancel`
+};
+
+// Opens `path` as described by `plan`. Falls back to buffered I/O (and
+// clears plan.direct_io) when the filesystem refuses O_DIRECT, and to
+// pwrite when the file cannot be mapped.
+bool open_shred_target(const char* path, const IoPlan& plan,
+                       long logical_block_size, ShredContext& ctx);
+void close_shred_target(ShredContext& ctx);
+
+// Overwrite the whole file once with `pattern` and flush it to the device.
+// A random pattern must have been seeded with seed_pass().
+// Short writes and transient errors are retried in place; units that still
+// fail are retried once more after the others, then listed in
+// ctx.failed_ranges. Returns false if any range was left unwritten.
+//
+// Once *ctx.cancel is set, no further units are started: writes already
+// issued complete, the file is flushed as usual, and run_pass returns
+// false with ctx.cancelled set (unless nothing was left to write).
+bool run_pass(ShredContext& ctx, const PassPattern& pattern);
+
+#endif // ENGINE_H
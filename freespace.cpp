@@ -0,0 +1,166 @@
+// Parallel Digital Shredder - Free-Space Wipe
+// fallocate reserves the blocks up front, so the overwrite passes land on
+// them in place and never race other writers into ENOSPC
+
+#include <iostream>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <omp.h>
+#include "freespace.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/statvfs.h>
+#include <linux/fs.h>
+#endif
+
+using namespace std;
+
+// Largest single fill file; bigger volumes get several, created in parallel
+static const long FILL_FILE_MAX = 16L * 1024 * 1024 * 1024;
+
+#ifdef _WIN32
+long available_space(const char*) {
+    return -1;
+}
+
+bool create_fill_files(const char*, long, vector<FillFile>&) {
+    cerr << "Error: Free-space wipe is not supported on this platform\n";
+    return false;
+}
+
+bool trim_free_space(const char*) {
+    return false;
+}
+#else
+long available_space(const char* dir) {
+    struct statvfs fs;
+    if (statvfs(dir, &fs) != 0) {
+        return -1;
+    }
+    return static_cast<long>(fs.f_bavail * fs.f_frsize);
+}
+
+// Preallocate up to `size` bytes, halving on ENOSPC; returns the size
+// claimed, 0 on failure with errno set
+static long preallocate(int fd, long size) {
+    while (size >= FILL_FILE_MIN) {
+        if (fallocate(fd, 0, 0, size) == 0) {
+            return size;
+        }
+        if (errno != ENOSPC) {
+            return 0;
+        }
+        size = (size / 2) & ~(FILL_FILE_MIN - 1);
+    }
+    errno = ENOSPC;
+    return 0;
+}
+
+// Preallocate fill files for `claim` bytes in parallel, numbered from
+// `next_index`; returns the bytes claimed. Errors other than ENOSPC are
+// kept in `first_error`.
+static long claim_space(const char* dir, long claim, long& next_index,
+                        vector<FillFile>& files, int& first_error) {
+    long count = (claim + FILL_FILE_MAX - 1) / FILL_FILE_MAX;
+    long per_file = (claim / count) & ~(FILL_FILE_MIN - 1);
+    const long first_index = next_index;
+    next_index += count;
+
+    vector<FillFile> planned(count);
+
+    #pragma omp parallel for schedule(dynamic)
+    for (long i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/.shredder-fill-%04ld", first_index + i);
+        planned[i].path = string(dir) + name;
+        planned[i].size = 0;
+
+        int fd = open(planned[i].path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        long size = (fd >= 0) ? preallocate(fd, per_file) : 0;
+        int error = errno;
+        if (fd >= 0) {
+            close(fd);
+            if (size == 0) {
+                unlink(planned[i].path.c_str());
+            }
+        }
+
+        if (size > 0) {
+            planned[i].size = size;
+        } else if (error != ENOSPC) {
+            #pragma omp critical
+            if (first_error == 0) {
+                first_error = error;
+            }
+        }
+    }
+
+    long claimed = 0;
+    for (const FillFile& file : planned) {
+        if (file.size > 0) {
+            files.push_back(file);
+            claimed += file.size;
+        }
+    }
+    return claimed;
+}
+
+bool create_fill_files(const char* dir, long reserve, vector<FillFile>& files) {
+    long available = available_space(dir);
+    long claim = available - reserve;
+    if (available < 0 || claim < FILL_FILE_MIN) {
+        cerr << "Error: No free space above the reserve in " << dir << "\n";
+        return false;
+    }
+
+    // A file that hit ENOSPC was halved, leaving the rest of its share
+    // free; smaller files take it until the reserve is reached or nothing
+    // more fits
+    long next_index = 0;
+    int first_error = 0;
+    while (claim >= FILL_FILE_MIN && first_error == 0) {
+        if (claim_space(dir, claim, next_index, files, first_error) == 0) {
+            break;
+        }
+        claim = available_space(dir) - reserve;
+    }
+
+    // ENOSPC only means the estimate was optimistic; anything else (no
+    // fallocate support, permissions) would leave holes in the wipe
+    if (first_error != 0) {
+        cerr << "Error: Cannot preallocate fill files in " << dir << ": "
+             << strerror(first_error) << "\n";
+        for (const FillFile& file : files) {
+            unlink(file.path.c_str());
+        }
+        files.clear();
+        return false;
+    }
+
+    if (files.empty()) {
+        cerr << "Error: No free space could be claimed in " << dir << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool trim_free_space(const char* dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct fstrim_range range;
+    range.start = 0;
+    range.len = ULLONG_MAX;
+    range.minlen = 0;
+    int result = ioctl(fd, FITRIM, &range);
+    close(fd);
+    return result == 0;
+}
+#endif
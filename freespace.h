@@ -0,0 +1,30 @@
+// Parallel Digital Shredder - Free-Space Wipe
+// Preallocated fill files that claim a volume's unallocated blocks
+
+#ifndef FREESPACE_H
+#define FREESPACE_H
+
+#include <string>
+#include <vector>
+
+// Smallest fill file; smaller leftovers are not worth one
+const long FILL_FILE_MIN = 1024 * 1024;
+
+struct FillFile {
+    std::string path;
+    long size;
+};
+
+// Bytes an unprivileged writer can still allocate under `dir`, or -1
+long available_space(const char* dir);
+
+// Preallocate hidden fill files in `dir`, in parallel, until only
+// `reserve` bytes remain free or the filesystem reports ENOSPC even for
+// the smallest file.
+// Returns false (after removing partial files) if nothing could be claimed.
+bool create_fill_files(const char* dir, long reserve, std::vector<FillFile>& files);
+
+// Discard the whole free space of the filesystem holding `dir` (FITRIM)
+bool trim_free_space(const char* dir);
+
+#endif // FREESPACE_H
@@ -0,0 +1,211 @@
+// Parallel Digital Shredder - Latency Histograms
+// Each counter has a single writer, so updates are plain relaxed
+// load/store pairs: no locked instructions on the hot path
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include "histogram.h"
+
+using namespace std;
+
+static const char* const STAGE_NAMES[] = {
+    "fill", "wait", "write", "flush", "trim", "verify"
+};
+
+const char* stage_name(Stage stage) {
+    return STAGE_NAMES[stage];
+}
+
+// Values below SUB_BUCKETS map 1:1; above, the top SUB_BITS + 1 bits pick
+// the bucket, so each power of two is split into SUB_BUCKETS linear steps
+static int bucket_index(uint64_t value) {
+    if (value < static_cast<uint64_t>(LatencyHistogram::SUB_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - LatencyHistogram::SUB_BITS;
+    if (shift > LatencyHistogram::MAX_SHIFT) {
+        return LatencyHistogram::BUCKETS - 1;
+    }
+    int sub = static_cast<int>(value >> shift) & (LatencyHistogram::SUB_BUCKETS - 1);
+    return (shift + 1) * LatencyHistogram::SUB_BUCKETS + sub;
+}
+
+static uint64_t bucket_floor(int index) {
+    if (index < LatencyHistogram::SUB_BUCKETS) {
+        return index;
+    }
+    int shift = index / LatencyHistogram::SUB_BUCKETS - 1;
+    uint64_t sub = index % LatencyHistogram::SUB_BUCKETS;
+    return (LatencyHistogram::SUB_BUCKETS + sub) << shift;
+}
+
+static void add_relaxed(atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+LatencyHistogram::LatencyHistogram()
+    : samples(0), sum(0), largest(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    add_relaxed(buckets[bucket_index(nanoseconds)], 1);
+    add_relaxed(samples, 1);
+    add_relaxed(sum, nanoseconds);
+    if (nanoseconds > largest.load(memory_order_relaxed)) {
+        largest.store(nanoseconds, memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::merge_from(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; i++) {
+        add_relaxed(buckets[i], other.buckets[i].load(memory_order_relaxed));
+    }
+    add_relaxed(samples, other.samples.load(memory_order_relaxed));
+    add_relaxed(sum, other.sum.load(memory_order_relaxed));
+    uint64_t other_max = other.largest.load(memory_order_relaxed);
+    if (other_max > largest.load(memory_order_relaxed)) {
+        largest.store(other_max, memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::count() const {
+    return samples.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::total() const {
+    return sum.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return largest.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    // Count from the buckets themselves: `samples` may be ahead of them
+    // while a worker is mid-record
+    uint64_t in_buckets = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        in_buckets += buckets[i].load(memory_order_relaxed);
+    }
+    if (in_buckets == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(fraction * (in_buckets - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i].load(memory_order_relaxed);
+        if (seen >= rank) {
+            return bucket_floor(i);
+        }
+    }
+    return max();
+}
+
+uint64_t LatencyHistogram::count_at_most(uint64_t nanoseconds) const {
+    uint64_t total_count = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        // The last bucket also holds everything beyond the range
+        bool last = (i == BUCKETS - 1);
+        if (last ? nanoseconds != UINT64_MAX : bucket_floor(i + 1) - 1 > nanoseconds) {
+            break;
+        }
+        total_count += buckets[i].load(memory_order_relaxed);
+    }
+    return total_count;
+}
+
+JobStats::JobStats(int worker_slots)
+    : workers(worker_slots),
+      slots(new StageHistograms[worker_slots + 1]) {
+}
+
+void JobStats::snapshot(StageHistograms& out) const {
+    for (int slot = 0; slot <= workers; slot++) {
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            out.stages[stage].merge_from(slots[slot].stages[stage]);
+        }
+    }
+}
+
+// Nanoseconds as a short human-readable duration
+static void format_duration(uint64_t nanoseconds, char* buffer, size_t size) {
+    if (nanoseconds < 10000) {
+        snprintf(buffer, size, "%lu ns", static_cast<unsigned long>(nanoseconds));
+    } else if (nanoseconds < 10000000) {
+        snprintf(buffer, size, "%.1f us", nanoseconds / 1e3);
+    } else if (nanoseconds < 10000000000ULL) {
+        snprintf(buffer, size, "%.1f ms", nanoseconds / 1e6);
+    } else {
+        snprintf(buffer, size, "%.2f s", nanoseconds / 1e9);
+    }
+}
+
+void print_stage_table(const StageHistograms& stats, ostream& out) {
+    char line[160];
+    snprintf(line, sizeof(line), "  %-6s %10s %10s %10s %10s %10s\n",
+             "stage", "count", "p50", "p99", "max", "total");
+    out << line;
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const LatencyHistogram& histogram = stats.stages[stage];
+        if (histogram.count() == 0) {
+            continue;
+        }
+
+        char p50[24], p99[24], largest[24], total[24];
+        format_duration(histogram.percentile(0.50), p50, sizeof(p50));
+        format_duration(histogram.percentile(0.99), p99, sizeof(p99));
+        format_duration(histogram.max(), largest, sizeof(largest));
+        format_duration(histogram.total(), total, sizeof(total));
+        snprintf(line, sizeof(line), "  %-6s %10lu %10s %10s %10s %10s\n",
+                 stage_name(static_cast<Stage>(stage)),
+                 static_cast<unsigned long>(histogram.count()), p50, p99, largest, total);
+        out << line;
+    }
+}
+
+StatsReporter::StatsReporter(const JobStats& stats, double interval_sec)
+    : stats(stats),
+      interval(interval_sec) {
+    worker = thread(&StatsReporter::run, this);
+}
+
+StatsReporter::~StatsReporter() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void StatsReporter::run() {
+    auto start = chrono::steady_clock::now();
+    auto period = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(interval));
+    auto next = start + period;
+
+    unique_lock<mutex> guard(lock);
+    while (!wake.wait_until(guard, next, [this] { return stopping; })) {
+        StageHistograms snapshot;
+        stats.snapshot(snapshot);
+
+        // Built first so the table is not interleaved with pass output
+        ostringstream text;
+        char header[64];
+        snprintf(header, sizeof(header), "\n  [stats +%.1fs]\n",
+                 chrono::duration<double>(next - start).count());
+        text << header;
+        print_stage_table(snapshot, text);
+        cout << text.str() << flush;
+
+        next += period;
+    }
+}
@@ -0,0 +1,103 @@
+// Parallel Digital Shredder - Latency Histograms
+// Log-linear (HDR-style) buckets, one set per thread, merged when read
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+enum Stage {
+    STAGE_FILL,       // pattern generation into a buffer or mapped pages
+    STAGE_WAIT,       // throttle and buffer-ring waits before a write
+    STAGE_WRITE,      // one write call, submission to completion
+    STAGE_FLUSH,      // fdatasync / msync at the end of a pass
+    STAGE_TRIM,       // hole punch or FITRIM
+    STAGE_VERIFY,     // read back and compare one unit
+    STAGE_COUNT
+};
+
+const char* stage_name(Stage stage);
+
+// Nanosecond latencies with ~3% relative error up to about two minutes.
+// record() must only be called by the owning thread; other threads may
+// merge_from() it meanwhile and see a slightly stale view.
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_SHIFT = 31;
+    static const int BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void merge_from(const LatencyHistogram& other);
+
+    uint64_t count() const;
+    uint64_t total() const;
+    uint64_t max() const;
+
+    // Lower bound of the bucket holding the given fraction (0..1) of samples
+    uint64_t percentile(double fraction) const;
+
+    // Samples in buckets that end at or below `nanoseconds`; UINT64_MAX
+    // counts every bucket, consistently with the bounded counts
+    uint64_t count_at_most(uint64_t nanoseconds) const;
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> largest;
+};
+
+struct StageHistograms {
+    LatencyHistogram stages[STAGE_COUNT];
+};
+
+// One StageHistograms per engine worker (ShredContext::worker_base plus
+// the OpenMP thread number, so concurrent files use disjoint ranges) plus
+// one for the delete pipeline thread
+class JobStats {
+public:
+    explicit JobStats(int worker_slots);
+
+    int worker_slots() const { return workers; }
+    StageHistograms& worker(int index) { return slots[index]; }
+    StageHistograms& deleter() { return slots[workers]; }
+
+    // Sum of every slot, safe while workers are recording
+    void snapshot(StageHistograms& out) const;
+
+private:
+    int workers;
+    std::unique_ptr<StageHistograms[]> slots;
+};
+
+// One line per stage that saw samples: count, p50, p99, max, total time
+void print_stage_table(const StageHistograms& stats, std::ostream& out);
+
+// Background thread printing the merged table every `interval_sec`
+class StatsReporter {
+public:
+    StatsReporter(const JobStats& stats, double interval_sec);
+    ~StatsReporter();
+
+private:
+    const JobStats& stats;
+    double interval;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    void run();
+};
+
+#endif // HISTOGRAM_H
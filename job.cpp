@@ -0,0 +1,544 @@
+// Parallel Digital Shredder - Shred Job
+// Everything between "this path" and "this path is gone" for one file;
+// front ends only decide which files, with which options and prompts
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sys/stat.h>
+#include <omp.h>
+#include "shredder.h"
+#include "cpu.h"
+#include "delete.h"
+#include "engine.h"
+#include "job.h"
+#include "keystream.h"
+#include "numa.h"
+#include "topology.h"
+#include "verify.h"
+
+using namespace std;
+
+// Report the device, filesystem and copy-on-write state behind `path`
+void detect_storage(const char* path, ShredTarget& target, ostream& out) {
+    // Detect if the storage device is an SSD
+    target.is_ssd = is_ssd(path);
+    if (target.is_ssd) {
+        out << "  + Storage: SSD detected (TRIM will be used)\n";
+    } else {
+        out << "  + Storage: HDD/Standard\n";
+    }
+
+    const StorageInfo& storage = storage_info(path);
+    target.storage = &storage;
+    if (storage.valid) {
+        char io_buffer[50];
+        format_bytes(storage.optimal_io_size, io_buffer, sizeof(io_buffer));
+        out << "  + Device: " << storage.device << " (" << storage.fs_type;
+        if (storage.discard_granularity > 0) out << ", discard";
+        if (storage.optimal_io_size > 0) out << ", optimal I/O " << io_buffer;
+        out << ")\n";
+    } else if (!storage.fs_type.empty()) {
+        out << "  + Device: none (" << storage.fs_type << ")\n";
+    }
+
+    CowInfo& cow = target.cow;
+    cow = inspect_cow(path, storage);
+    if (cow.copy_on_write) {
+        out << "  + Copy-on-write: " << (cow.shared_extents ? "shared extents" : "new extents per pass")
+             << "\n";
+    } else if (cow.nocow) {
+        out << "  + Copy-on-write: disabled for this file (nodatacow), overwrites in place\n";
+    }
+    if (cow.shared_extents) {
+        cerr << "Warning: Extents are shared with reflinked copies or snapshots;\n"
+             << "         those copies keep the original data\n";
+    }
+}
+
+// Validate `path` and report what the storage detection found
+bool inspect_target(const char* path, ShredTarget& target, ostream& out) {
+    auto start = chrono::steady_clock::now();
+    target.path = path;
+    target.report.path = path;
+
+    out << "\nValidating " << path << " ...\n";
+
+    if (!validate_file(path)) {
+        cerr << "Error: File validation failed\n";
+        target.report.status = "setup failed";
+        return false;
+    }
+
+    out << "  + File OK\n";
+
+    detect_storage(path, target, out);
+    target.report.setup_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void report_file(JobResources& job, const FileReport& report) {
+    if (job.report) {
+        job.report->add(report);
+    }
+}
+
+// Once the pipeline has finished: how long each of `paths` took to delete
+void report_deletes(JobResources& job, DeletePipeline& deleter,
+                    const vector<string>& paths) {
+    if (job.report) {
+        for (const string& path : paths) {
+            job.report->record_delete(path, deleter.delete_seconds(path));
+        }
+    }
+}
+
+// Ranges listed in full up to this many; the rest are summarised
+static const size_t MAX_REPORTED_RANGES = 16;
+
+// Which bytes of the file a failed pass left unwritten, and why
+static void report_failed_ranges(const ShredContext& ctx) {
+    const vector<FailedRange>& ranges = ctx.failed_ranges;
+    if (ranges.empty()) {
+        return;
+    }
+    cerr << "  " << ranges.size() << " range" << (ranges.size() > 1 ? "s" : "")
+         << " not written:\n";
+    for (size_t i = 0; i < ranges.size() && i < MAX_REPORTED_RANGES; i++) {
+        const FailedRange& range = ranges[i];
+        cerr << "    bytes " << range.offset << "-" << (range.offset + range.length - 1)
+             << ": " << range.stage << " failed: " << strerror(range.error) << "\n";
+    }
+    if (ranges.size() > MAX_REPORTED_RANGES) {
+        cerr << "    ... and " << (ranges.size() - MAX_REPORTED_RANGES) << " more\n";
+    }
+}
+
+// Where the readback differed from the pass, or why it could not be read
+static void report_mismatches(const VerifyResult& result) {
+    if (result.read_error) {
+        cerr << "    read failed at byte " << result.read_error_offset << ": "
+             << strerror(result.read_error) << "\n";
+    }
+    if (result.mismatched_units == 0) {
+        return;
+    }
+    cerr << "  " << result.mismatched_units
+         << (result.mismatched_units > 1 ? " units differ" : " unit differs")
+         << " from the pattern written:\n";
+    for (size_t i = 0; i < result.mismatches.size() && i < MAX_REPORTED_RANGES; i++) {
+        cerr << "    first mismatch at byte " << result.mismatches[i] << "\n";
+    }
+    if (result.mismatched_units > static_cast<long>(MAX_REPORTED_RANGES)) {
+        cerr << "    ... and " << (result.mismatched_units - MAX_REPORTED_RANGES) << " more\n";
+    }
+}
+
+// Crypto-erase: once the key is gone, nothing written under it can be
+// regenerated or told apart from noise
+void discard_job_key(ostream& out) {
+    forget_job_key();
+    out << "  + Key discarded (keystream cannot be regenerated)\n";
+}
+
+// Stopped on request: everything written so far has been flushed
+static bool finish_cancelled(ShredContext& ctx, FileReport& report, JobResources& job,
+                             chrono::steady_clock::time_point start_time) {
+    cerr << "\nWarning: Cancelled, file is only partially overwritten\n";
+    close_shred_target(ctx);
+    report.status = "cancelled";
+    report.overwrite_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    job.progress.pass = 0;
+    return false;
+}
+
+// Plan, configure and run every pass of `schedule` over an inspected target
+bool shred_target(ShredTarget& target, const JobOptions& options,
+                  PassSchedule schedule, JobResources& job, ostream& out) {
+    auto setup_start = chrono::steady_clock::now();
+    FileReport& report = target.report;
+    report.path = target.path;
+    report.profile = schedule.name;
+    if (job.cancel) {
+        report.status = "cancelled";
+        return false;
+    }
+    const char* file_path = target.path;
+    const StorageInfo& storage = *target.storage;
+    const CowInfo& cow = target.cow;
+    int passes = static_cast<int>(schedule.passes.size());
+
+    DeviceClass device_class = classify_device(storage, target.is_ssd);
+    if (options.device_class_set) {
+        device_class = options.device_class;
+    }
+
+    struct stat file_stat;
+    long file_size_hint = (stat(file_path, &file_stat) == 0) ? file_stat.st_size : 0;
+
+    IoPlan plan = select_io_plan(device_class, storage, file_size_hint, omp_get_max_threads());
+    if (options.num_threads > 0) {
+        plan.threads = options.num_threads;
+    }
+    if (target.cpu_share > 0) {
+        plan.threads = min(plan.threads, target.cpu_share);
+    }
+    if (options.pipeline_set) {
+        plan.pipeline = options.pipeline;
+    }
+    if (options.writers > 0) {
+        plan.writers = options.writers;
+    }
+    if (plan.pipeline == PIPELINE_CHUNKED) {
+        plan.writers = plan.threads;
+        plan.queue_depth = plan.threads;
+    } else {
+        if (plan.pipeline == PIPELINE_SEQUENTIAL || plan.writers < 1) {
+            plan.writers = 1;
+        }
+        // At least one thread must be left to generate data
+        plan.writers = min(plan.writers, max(plan.threads - 1, 1));
+        // Enough slots for every writer plus work queued ahead of them
+        plan.queue_depth = max(plan.queue_depth, 2 * plan.threads);
+    }
+    if (options.unit_size > 0) {
+        plan.unit_size = options.unit_size;
+    }
+    if (options.direct_io >= 0) {
+        plan.direct_io = (options.direct_io == 1);
+    }
+    // Mapped pages always go through the page cache
+    if (options.backend_set) {
+        plan.backend = options.backend;
+    } else if (options.direct_io == 1) {
+        plan.backend = BACKEND_PWRITE;
+    }
+    if (plan.backend == BACKEND_MMAP) {
+        plan.direct_io = false;
+    }
+    if (target.is_ssd) {
+        plan.use_trim = true;
+    }
+    // The file is deleted right after its pass; release its blocks too
+    if (schedule.crypto_erase) {
+        plan.use_trim = true;
+    }
+
+    // Intermediate passes land on different physical blocks than the old
+    // data here, so only the final pattern is worth writing
+    const char* coalesce_reason = NULL;
+    if (options.coalesce && passes > 1) {
+        coalesce_reason = redundant_pass_reason(device_class, storage, cow);
+        if (coalesce_reason) {
+            schedule.passes.erase(schedule.passes.begin(), schedule.passes.end() - 1);
+            plan.use_trim = true;
+        }
+    }
+    // Each pass on a COW file is written to freshly allocated extents, so
+    // extra passes never touch the old blocks and only multiply the writes
+    bool cow_collapsed = false;
+    if (cow.copy_on_write && !options.keep_passes && schedule.passes.size() > 1) {
+        schedule.passes.erase(schedule.passes.begin(), schedule.passes.end() - 1);
+        cow_collapsed = true;
+    }
+    int requested_passes = passes;
+    passes = static_cast<int>(schedule.passes.size());
+
+    // Old extents are only released when the transaction commits, which may
+    // be after the job ends; make sure every pass has room up front.
+    // Preallocated extents take the first pass in place.
+    int cow_passes = target.preallocated ? passes - 1 : passes;
+    if (cow.copy_on_write && cow_passes > 0 && cow.free_bytes >= 0 &&
+        cow.free_bytes / cow_passes < file_size_hint) {
+        char need_buffer[50], free_buffer[50];
+        format_bytes(file_size_hint * cow_passes, need_buffer, sizeof(need_buffer));
+        format_bytes(cow.free_bytes, free_buffer, sizeof(free_buffer));
+        cerr << "\nError: Not enough free space for a copy-on-write overwrite (need "
+             << need_buffer << ", " << free_buffer << " available)\n";
+        job.progress.setup_errors++;
+        report.status = "setup failed";
+        return false;
+    }
+
+    ShredContext ctx;
+    if (!open_shred_target(file_path, plan, storage.logical_block_size, ctx)) {
+        cerr << "\nError: Cannot open file for writing\n";
+        job.progress.setup_errors++;
+        report.status = "setup failed";
+        return false;
+    }
+
+    long file_size = ctx.file_size;
+    if (file_size <= 0) {
+        cerr << "\nError: Invalid file size\n";
+        close_shred_target(ctx);
+        job.progress.setup_errors++;
+        report.status = "setup failed";
+        return false;
+    }
+    int num_threads = ctx.plan.threads;
+
+    // Without an explicit count, random passes ramp the workers up towards
+    // the plan's count; a count tuned earlier on the same device is reused.
+    // Other passes are not measured and always run at the plan's count,
+    // and a ramp needs at least two random passes to compare.
+    int random_passes = 0;
+    for (const PassPattern& pattern : schedule.passes) {
+        random_passes += (pattern.kind == FILL_RANDOM);
+    }
+    string tune_key = storage.device.empty() ? storage.fs_type : storage.device;
+    bool automatic = options.num_threads == 0 && ctx.plan.backend == BACKEND_PWRITE;
+    int remembered = automatic ? remembered_threads(tune_key) : 0;
+    if (remembered == 0 && (!automatic || random_passes < 2)) {
+        remembered = num_threads;
+    }
+    ThreadTuner tuner(num_threads, remembered);
+    bool was_settled = tuner.settled();
+
+    char size_buffer[50];
+    format_bytes(file_size, size_buffer, sizeof(size_buffer));
+    char unit_buffer[50];
+    format_bytes(ctx.plan.unit_size, unit_buffer, sizeof(unit_buffer));
+
+    out << "\nConfiguration:\n";
+    out << "  Size: " << size_buffer << " | Passes: " << passes << " | Threads: " << num_threads;
+    if (!was_settled) {
+        out << " (random passes adaptive from " << tuner.threads() << ")";
+    } else if (tuner.threads() != num_threads) {
+        out << " (random passes " << tuner.threads() << ", tuned earlier)";
+    }
+    out << "\n";
+    if (schedule.name != "default") {
+        out << "  Profile: " << schedule.name;
+        if (schedule.crypto_erase) {
+            out << " (key discarded after the pass, then delete)";
+        }
+        out << "\n";
+    }
+    if (coalesce_reason) {
+        out << "  Coalesced: " << requested_passes << " passes -> final pass + discard ("
+             << coalesce_reason << ")\n";
+    }
+    if (cow_collapsed) {
+        out << "  Copy-on-write: " << requested_passes
+             << " passes -> final pass (use --keep-passes to override)\n";
+    }
+    out << "  Strategy: " << device_class_name(ctx.plan.device_class);
+    if (ctx.plan.backend == BACKEND_MMAP) {
+        out << " | mmap (msync per pass)";
+    } else {
+        out << " | " << pipeline_name(ctx.plan.pipeline);
+        if (ctx.plan.pipeline != PIPELINE_CHUNKED) {
+            // The engine keeps one thread generating at the starting count
+            int writers = min(ctx.plan.writers, max(tuner.threads() - 1, 1));
+            out << " (" << writers << " writer" << (writers > 1 ? "s" : "")
+                 << ", " << ctx.plan.queue_depth << " buffers)";
+        }
+        out << " | " << unit_buffer << " writes"
+             << " | " << (ctx.plan.direct_io ? "direct" : "buffered") << " I/O";
+    }
+    out << (ctx.plan.use_trim ? " | TRIM" : "") << "\n";
+    out << "  Kernels: " << isa_name(active_isa());
+    if (active_isa() != detected_isa()) {
+        out << " (forced, CPU supports " << isa_name(detected_isa()) << ")";
+    }
+    out << " | " << keystream_name() << " random passes\n";
+    // Topology-aware placement: thread i runs on ctx.worker_cpus[i]
+    if (options.numa) {
+        int storage_node = storage_numa_node(file_path);
+        ctx.worker_cpus = plan_worker_cpus(num_threads, storage_node, target.cpu_base);
+        out << "  NUMA: " << numa_node_count() << " node(s), storage on ";
+        if (storage_node >= 0) {
+            out << "node " << storage_node;
+        } else {
+            out << "unknown node";
+        }
+        out << ", workers pinned\n";
+    }
+
+    if (options.rate_mb > 0 || options.iops > 0) {
+        out << "  Throttle:";
+        if (options.rate_mb > 0) out << " " << options.rate_mb << " MB/s";
+        if (options.iops > 0) out << " " << options.iops << " IOPS";
+        if (options.target_latency_ms > 0) {
+            out << " (adaptive, target " << options.target_latency_ms << " ms)";
+        }
+        out << "\n";
+    }
+    if (options.low_priority) {
+        out << "  Priority: idle I/O class, nice 19\n";
+    }
+
+    out << "\nShredding...\n";
+
+    // Initialize progress tracking
+    ctx.limiter = job.limiter.get();
+    ctx.cancel = &job.cancel;
+    ctx.stats = job.stats.get();
+    ctx.worker_base = target.worker_base;
+    ctx.progress = &job.progress;
+    job.progress.file_size = file_size;
+    job.progress.passes = passes;
+
+    report.size = file_size;
+    report.device_class = device_class_name(ctx.plan.device_class);
+    report.backend = backend_name(ctx.plan.backend);
+    report.pipeline = (ctx.plan.backend == BACKEND_MMAP) ? "" : pipeline_name(ctx.plan.pipeline);
+    report.direct_io = ctx.plan.direct_io;
+    report.setup_seconds += chrono::duration<double>(chrono::steady_clock::now() - setup_start).count();
+
+    auto start_time = chrono::steady_clock::now();
+    long retries = 0;
+
+    // Progress monitoring in separate section
+    for (int pass = 1; pass <= passes; pass++) {
+        // Cancelled during the previous pass's readback
+        if (job.cancel) {
+            out << "  Cancelled before pass " << pass << "/" << passes << "\n";
+            return finish_cancelled(ctx, report, job, start_time);
+        }
+
+        // Random passes get their own nonce, kept for the readback
+        PassPattern pattern = schedule.passes[pass - 1];
+        seed_pass(pattern);
+        string name = pattern_name(pattern);
+
+        // OpenMP parallel region inside: each thread processes its chunk
+        ctx.plan.threads = (pattern.kind == FILL_RANDOM) ? tuner.threads() : num_threads;
+        job.progress.pass_start_bytes = job.progress.bytes_written.load();
+        job.progress.pass = pass;
+        auto pass_start = chrono::steady_clock::now();
+        bool pass_ok = run_pass(ctx, pattern);
+        double pass_seconds = chrono::duration<double>(chrono::steady_clock::now() - pass_start).count();
+        report.passes.push_back(PassReport{name, pass_seconds});
+        report.threads = max(report.threads, ctx.plan.threads);
+        long pass_retries = ctx.write_retries.exchange(0);
+        retries += pass_retries;
+        job.progress.write_retries += pass_retries;
+
+        // Only random passes are bound by generation, which more threads speed up
+        if (pass_ok && pattern.kind == FILL_RANDOM) {
+            tuner.record(file_size, pass_seconds);
+        }
+
+        if (!pass_ok && ctx.cancelled && ctx.failed_ranges.empty()) {
+            out << "  Pass " << pass << "/" << passes << " (" << name << ") cancelled\n";
+            return finish_cancelled(ctx, report, job, start_time);
+        }
+        if (!pass_ok) {
+            out << "  Pass " << pass << "/" << passes << " (" << name << ") failed\n";
+            cerr << "\nError: Write failed, file is only partially overwritten\n";
+            report_failed_ranges(ctx);
+            close_shred_target(ctx);
+            report.status = "write failed";
+            report.overwrite_seconds = chrono::duration<double>(
+                chrono::steady_clock::now() - start_time).count();
+            job.progress.write_errors++;
+            job.progress.pass = 0;
+            return false;
+        }
+        
+        // Show completion for this pass
+        out << "  Pass " << pass << "/" << passes << " (" << name << ") ";
+        display_progress_bar(100, pass, passes);
+        out << " done\n";
+
+        if (options.verify == VERIFY_EVERY_PASS || (options.verify == VERIFY_FINAL && pass == passes)) {
+            auto verify_start = chrono::steady_clock::now();
+            VerifyResult result;
+            bool verified = verify_pass(ctx, file_path, pattern, result);
+            double verify_seconds = chrono::duration<double>(chrono::steady_clock::now() - verify_start).count();
+            report.verify_seconds = max(report.verify_seconds, 0.0) + verify_seconds;
+
+            if (!verified) {
+                out << "  Verify " << pass << "/" << passes << " (" << name << ") failed\n";
+                cerr << "\nError: Readback does not match the pattern written\n";
+                report_mismatches(result);
+                close_shred_target(ctx);
+                report.status = "verify failed";
+                report.overwrite_seconds = chrono::duration<double>(
+                    chrono::steady_clock::now() - start_time).count();
+                job.progress.verify_errors++;
+                job.progress.pass = 0;
+                return false;
+            }
+            out << "  Verify " << pass << "/" << passes << " (" << name << ") ok";
+            if (verify_seconds > 0) {
+                out << " (" << fixed << setprecision(2)
+                    << (result.bytes_checked / verify_seconds / (1024 * 1024)) << " MB/s, "
+                    << isa_name(active_isa()) << ")";
+            }
+            if (result.cache_only) {
+                out << " [page cache only: mapped file, no O_DIRECT]";
+            }
+            out << "\n";
+        }
+    }
+
+    // Fractional seconds: a small file can finish within a millisecond
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    report.overwrite_seconds = seconds;
+
+    close_shred_target(ctx);
+    job.progress.pass = 0;
+    job.progress.files_done++;
+
+    if (retries > 0) {
+        out << "  Retried: " << retries << " short or interrupted write"
+             << (retries > 1 ? "s" : "") << "\n";
+    }
+    if (!was_settled && tuner.settled()) {
+        remember_threads(tune_key, tuner.threads());
+        out << "  Threads: settled at " << tuner.threads() << "\n";
+    }
+
+    out << "\nCompleted in " << fixed << setprecision(1) << seconds * 1000 << " ms";
+    if (seconds > 0) {
+        out << " (" << setprecision(2)
+             << (static_cast<double>(file_size) * passes / seconds / (1024 * 1024)) << " MB/s)";
+    }
+    out << "\n";
+
+    target.file_size = file_size;
+    target.use_trim = ctx.plan.use_trim;
+    return true;
+}
+
+bool run_file_job(const char* path, const JobOptions& options, const PassSchedule& schedule,
+                  bool delete_file, JobResources& job, ostream& out, string& message) {
+    job.progress.files_total++;
+    // Each job is a job of its own: a fresh key for its random passes
+    new_job_key();
+
+    ShredTarget target;
+    if (!inspect_target(path, target, out)) {
+        job.progress.setup_errors++;
+        report_file(job, target.report);
+        message = "validation failed";
+        return false;
+    }
+    bool shredded = shred_target(target, options, schedule, job, out);
+    report_file(job, target.report);
+    if (schedule.crypto_erase) {
+        discard_job_key(out);
+    }
+    if (!shredded) {
+        message = target.report.status;
+        return false;
+    }
+    if (!delete_file && !schedule.crypto_erase) {
+        return true;
+    }
+
+    DeletePipeline deleter(options.obfuscate, job.stats.get());
+    deleter.submit(path, target.file_size, target.use_trim);
+    bool deleted = deleter.finish().empty();
+    report_deletes(job, deleter, vector<string>(1, path));
+    if (!deleted) {
+        job.progress.delete_errors++;
+        message = "delete failed";
+    }
+    return deleted;
+}
@@ -0,0 +1,107 @@
+// Parallel Digital Shredder - Shred Job
+// Inspect, plan, overwrite, verify and delete one file; shared by the
+// command line, the daemon and the embedding API
+
+#ifndef JOB_H
+#define JOB_H
+
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cow.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "pattern.h"
+#include "report.h"
+#include "strategy.h"
+#include "throttle.h"
+
+class DeletePipeline;
+struct StorageInfo;
+
+// Which passes are read back and compared after their flush
+enum VerifyMode {
+    VERIFY_OFF,
+    VERIFY_FINAL,       // only the pattern left on the device
+    VERIFY_EVERY_PASS
+};
+
+// Per-job engine settings; anything left at its default is chosen from
+// the device by the I/O strategy
+struct JobOptions {
+    int num_threads = 0;
+    bool coalesce = false;
+    bool keep_passes = false;
+    bool numa = false;
+    bool device_class_set = false;
+    DeviceClass device_class = DEVICE_UNKNOWN;
+    long unit_size = 0;
+    int direct_io = -1;             // -1 = strategy default, 0/1 = forced
+    bool backend_set = false;
+    IoBackend backend = BACKEND_PWRITE;
+    bool pipeline_set = false;
+    PipelineKind pipeline = PIPELINE_CHUNKED;
+    int writers = 0;
+    double rate_mb = 0.0;
+    double iops = 0.0;
+    double target_latency_ms = 0.0;
+    bool low_priority = false;
+    bool obfuscate = false;
+    VerifyMode verify = VERIFY_OFF;
+};
+
+// Shared by every file and worker of a job
+struct JobResources {
+    std::unique_ptr<RateLimiter> limiter;   // caps apply to the whole job
+    std::unique_ptr<JobStats> stats;        // with --stats or --metrics-file
+    JobProgress progress;
+    std::unique_ptr<JobReport> report;      // with --report
+    // Graceful stop: the running pass finishes its in-flight writes and
+    // is flushed, later passes and files are skipped (status "cancelled")
+    std::atomic<bool> cancel{false};
+};
+
+// One file of a job: what detection found before the user confirms, and
+// what the shredding left for the delete stage
+struct ShredTarget {
+    const char* path = nullptr;
+    bool is_ssd = false;
+    const StorageInfo* storage = nullptr;
+    CowInfo cow;
+    long file_size = 0;
+    bool use_trim = false;
+    bool preallocated = false;      // fill file: first pass lands in place
+    int cpu_share = 0;              // threads allowed for this file, 0 = all
+    int worker_base = 0;            // JobStats slot of this file's thread 0
+    int cpu_base = 0;               // position of its thread 0 in the --numa CPU order
+    FileReport report;
+};
+
+// Report the device, filesystem and copy-on-write state behind `path`
+void detect_storage(const char* path, ShredTarget& target, std::ostream& out);
+
+// Validate `path` and report what the storage detection found
+bool inspect_target(const char* path, ShredTarget& target, std::ostream& out);
+
+// Plan, configure and run every pass of `schedule` over an inspected target
+bool shred_target(ShredTarget& target, const JobOptions& options,
+                  PassSchedule schedule, JobResources& job, std::ostream& out);
+
+// Inspect, shred and, if asked (always for crypto-erase), delete one file
+// under a fresh job key, with no prompts. Returns false with `message`
+// set to the failed stage.
+bool run_file_job(const char* path, const JobOptions& options, const PassSchedule& schedule,
+                  bool delete_file, JobResources& job, std::ostream& out, std::string& message);
+
+void report_file(JobResources& job, const FileReport& report);
+
+// Once the pipeline has finished: how long each of `paths` took to delete
+void report_deletes(JobResources& job, DeletePipeline& deleter,
+                    const std::vector<std::string>& paths);
+
+// Crypto-erase: wipe the job key once everything written under it is done
+void discard_job_key(std::ostream& out);
+
+#endif // JOB_H
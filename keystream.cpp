@@ -0,0 +1,280 @@
+// Parallel Digital Shredder - Keystream
+// Counter-mode ciphers under one key per job: block N of a stream depends
+// only on the key, the pass nonce and N, so workers seek by file offset
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include "cpu.h"
+#include "keystream.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/random.h>
+#endif
+
+#ifdef HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// AES-128 uses the first 16 bytes, ChaCha20 all 32
+static const size_t KEY_BYTES = 32;
+static const int AES_ROUNDS = 10;
+
+struct JobKey {
+    unsigned char bytes[KEY_BYTES];
+    uint32_t chacha[8];                                 // key words, little-endian
+    alignas(16) unsigned char aes[(AES_ROUNDS + 1) * 16]; // expanded round keys
+};
+
+static JobKey job_key;
+static atomic<bool> key_ready(false);
+static mutex key_lock;
+
+void system_random(void* buffer, size_t size) {
+    unsigned char* out = static_cast<unsigned char*>(buffer);
+#ifndef _WIN32
+    while (size > 0) {
+        ssize_t count = getrandom(out, size, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        out += count;
+        size -= count;
+    }
+#endif
+    // No getrandom(): random_device is the platform CSPRNG (rand_s,
+    // /dev/urandom) on every supported toolchain
+    if (size > 0) {
+        random_device device;
+        for (size_t i = 0; i < size; i++) {
+            out[i] = static_cast<unsigned char>(device());
+        }
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("aes,sse2")))
+static __m128i expand_round(__m128i key, __m128i assist) {
+    assist = _mm_shuffle_epi32(assist, 0xFF);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// FIPS-197 key schedule; the round constant must be an immediate
+__attribute__((target("aes,sse2")))
+static void expand_aes_key(const unsigned char* key, unsigned char* rounds) {
+    __m128i* out = reinterpret_cast<__m128i*>(rounds);
+    out[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+#define EXPAND(i, rcon) out[i] = expand_round(out[i - 1], _mm_aeskeygenassist_si128(out[i - 1], rcon))
+    EXPAND(1, 0x01); EXPAND(2, 0x02); EXPAND(3, 0x04); EXPAND(4, 0x08); EXPAND(5, 0x10);
+    EXPAND(6, 0x20); EXPAND(7, 0x40); EXPAND(8, 0x80); EXPAND(9, 0x1B); EXPAND(10, 0x36);
+#undef EXPAND
+}
+#endif
+
+// Caller holds key_lock
+static void install_key(const unsigned char* bytes) {
+    memcpy(job_key.bytes, bytes, KEY_BYTES);
+    for (int i = 0; i < 8; i++) {
+        job_key.chacha[i] = static_cast<uint32_t>(bytes[4 * i]) |
+                            static_cast<uint32_t>(bytes[4 * i + 1]) << 8 |
+                            static_cast<uint32_t>(bytes[4 * i + 2]) << 16 |
+                            static_cast<uint32_t>(bytes[4 * i + 3]) << 24;
+    }
+#ifdef HAVE_X86_KERNELS
+    if (cpu_has_aes()) {
+        expand_aes_key(bytes, job_key.aes);
+    }
+#endif
+    key_ready.store(true, memory_order_release);
+}
+
+// Plain memset may be dropped as a dead store; the volatile writes are not
+static void wipe(void* buffer, size_t size) {
+    volatile unsigned char* bytes = static_cast<volatile unsigned char*>(buffer);
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = 0;
+    }
+}
+
+void new_job_key() {
+    unsigned char bytes[KEY_BYTES];
+    system_random(bytes, sizeof(bytes));
+    lock_guard<mutex> guard(key_lock);
+    install_key(bytes);
+    wipe(bytes, sizeof(bytes));
+}
+
+void forget_job_key() {
+    lock_guard<mutex> guard(key_lock);
+    key_ready.store(false, memory_order_release);
+    wipe(&job_key, sizeof(job_key));
+}
+
+static void ensure_key() {
+    if (key_ready.load(memory_order_acquire)) {
+        return;
+    }
+    unsigned char bytes[KEY_BYTES];
+    system_random(bytes, sizeof(bytes));
+    lock_guard<mutex> guard(key_lock);
+    if (!key_ready.load(memory_order_relaxed)) {
+        install_key(bytes);
+    }
+    wipe(bytes, sizeof(bytes));
+}
+
+// Whole blocks straight into the buffer; a partial block at either end
+// goes through a scratch block
+template <long Block, void (*Blocks)(unsigned char*, long, uint64_t, uint64_t)>
+static void keystream(unsigned char* buffer, long length, long offset, uint64_t nonce) {
+    unsigned char scratch[Block];
+    long skip = offset % Block;
+    if (skip > 0 && length > 0) {
+        long count = min(Block - skip, length);
+        Blocks(scratch, 1, offset / Block, nonce);
+        memcpy(buffer, scratch + skip, count);
+        buffer += count;
+        offset += count;
+        length -= count;
+    }
+
+    long whole = length / Block;
+    Blocks(buffer, whole, offset / Block, nonce);
+
+    long tail = length - whole * Block;
+    if (tail > 0) {
+        Blocks(scratch, 1, offset / Block + whole, nonce);
+        memcpy(buffer + whole * Block, scratch, tail);
+    }
+}
+
+static inline uint32_t rotate_left(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+#define QUARTER_ROUND(a, b, c, d)                                   \
+    x[a] += x[b]; x[d] = rotate_left(x[d] ^ x[a], 16);              \
+    x[c] += x[d]; x[b] = rotate_left(x[b] ^ x[c], 12);              \
+    x[a] += x[b]; x[d] = rotate_left(x[d] ^ x[a], 8);               \
+    x[c] += x[d]; x[b] = rotate_left(x[b] ^ x[c], 7)
+
+// Original ChaCha20 layout: words 12-13 hold a 64-bit block counter and
+// 14-15 the nonce, so one stream covers 2^70 bytes
+static void chacha20_blocks(unsigned char* out, long count, uint64_t first, uint64_t nonce) {
+    uint32_t state[16] = {
+        0x61707865, 0x3320646E, 0x79622D32, 0x6B206574,
+        job_key.chacha[0], job_key.chacha[1], job_key.chacha[2], job_key.chacha[3],
+        job_key.chacha[4], job_key.chacha[5], job_key.chacha[6], job_key.chacha[7],
+        0, 0, static_cast<uint32_t>(nonce), static_cast<uint32_t>(nonce >> 32)
+    };
+
+    for (long block = 0; block < count; block++) {
+        uint64_t counter = first + block;
+        state[12] = static_cast<uint32_t>(counter);
+        state[13] = static_cast<uint32_t>(counter >> 32);
+
+        uint32_t x[16];
+        memcpy(x, state, sizeof(x));
+        for (int round = 0; round < 10; round++) {
+            QUARTER_ROUND(0, 4, 8, 12);
+            QUARTER_ROUND(1, 5, 9, 13);
+            QUARTER_ROUND(2, 6, 10, 14);
+            QUARTER_ROUND(3, 7, 11, 15);
+            QUARTER_ROUND(0, 5, 10, 15);
+            QUARTER_ROUND(1, 6, 11, 12);
+            QUARTER_ROUND(2, 7, 8, 13);
+            QUARTER_ROUND(3, 4, 9, 14);
+        }
+
+        unsigned char* bytes = out + block * 64;
+        for (int i = 0; i < 16; i++) {
+            uint32_t word = x[i] + state[i];
+            bytes[4 * i] = static_cast<unsigned char>(word);
+            bytes[4 * i + 1] = static_cast<unsigned char>(word >> 8);
+            bytes[4 * i + 2] = static_cast<unsigned char>(word >> 16);
+            bytes[4 * i + 3] = static_cast<unsigned char>(word >> 24);
+        }
+    }
+}
+
+#undef QUARTER_ROUND
+
+void chacha20_keystream(unsigned char* buffer, long length, long offset, uint64_t nonce) {
+    keystream<64, chacha20_blocks>(buffer, length, offset, nonce);
+}
+
+#ifdef HAVE_X86_KERNELS
+// Counter block: 64-bit block number in the low half, nonce in the high
+// half. Eight blocks in flight hide the latency of AESENC.
+__attribute__((target("aes,sse2")))
+static void aes_ctr_blocks(unsigned char* out, long count, uint64_t first, uint64_t nonce) {
+    const __m128i* rounds = reinterpret_cast<const __m128i*>(job_key.aes);
+    __m128i key[AES_ROUNDS + 1];
+    for (int r = 0; r <= AES_ROUNDS; r++) {
+        key[r] = _mm_load_si128(rounds + r);
+    }
+
+    // Spelled out so the eight blocks stay in registers
+#define EIGHT(op) op(0); op(1); op(2); op(3); op(4); op(5); op(6); op(7)
+    __m128i counter = _mm_set_epi64x(static_cast<long long>(nonce), static_cast<long long>(first));
+    const __m128i one = _mm_set_epi64x(0, 1);
+    long i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+#define START(j) b##j = _mm_xor_si128(counter, key[0]); counter = _mm_add_epi64(counter, one)
+#define ROUND(j) b##j = _mm_aesenc_si128(b##j, key[r])
+#define STORE(j) _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i + j) * 16), \
+                                  _mm_aesenclast_si128(b##j, key[AES_ROUNDS]))
+        EIGHT(START);
+        for (int r = 1; r < AES_ROUNDS; r++) {
+            EIGHT(ROUND);
+        }
+        EIGHT(STORE);
+#undef START
+#undef ROUND
+#undef STORE
+    }
+#undef EIGHT
+    for (; i < count; i++) {
+        __m128i block = _mm_xor_si128(_mm_set_epi64x(static_cast<long long>(nonce),
+                                                     static_cast<long long>(first + i)), key[0]);
+        for (int r = 1; r < AES_ROUNDS; r++) {
+            block = _mm_aesenc_si128(block, key[r]);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 16),
+                         _mm_aesenclast_si128(block, key[AES_ROUNDS]));
+    }
+}
+
+void aes_ctr_keystream(unsigned char* buffer, long length, long offset, uint64_t nonce) {
+    keystream<16, aes_ctr_blocks>(buffer, length, offset, nonce);
+}
+#else
+void aes_ctr_keystream(unsigned char* buffer, long length, long offset, uint64_t nonce) {
+    chacha20_keystream(buffer, length, offset, nonce);
+}
+#endif
+
+static bool use_aes() {
+    return active_isa() > ISA_SCALAR && cpu_has_aes();
+}
+
+KeystreamKernel keystream_kernel() {
+    ensure_key();
+    return use_aes() ? aes_ctr_keystream : chacha20_keystream;
+}
+
+const char* keystream_name() {
+    return use_aes() ? "aes-128-ctr" : "chacha20";
+}
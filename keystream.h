@@ -0,0 +1,40 @@
+// Parallel Digital Shredder - Keystream
+// Cipher keystream behind random passes: AES-128-CTR or ChaCha20
+
+#ifndef KEYSTREAM_H
+#define KEYSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// `length` bytes of the keystream for `nonce`, starting at byte `offset`
+// of that stream. Blocks are addressed by offset, so any range can be
+// generated on its own, by any thread, in any order.
+typedef void (*KeystreamKernel)(unsigned char* buffer, long length, long offset, uint64_t nonce);
+
+// AES-128-CTR, 16-byte blocks; needs AES-NI
+void aes_ctr_keystream(unsigned char* buffer, long length, long offset, uint64_t nonce);
+
+// ChaCha20 with a 64-bit block counter, 64-byte blocks; portable
+void chacha20_keystream(unsigned char* buffer, long length, long offset, uint64_t nonce);
+
+// AES-128-CTR when the CPU has AES-NI and the active level is above
+// scalar (see cpu.h), otherwise ChaCha20. Makes the job key if needed.
+KeystreamKernel keystream_kernel();
+
+// "aes-128-ctr" or "chacha20"
+const char* keystream_name();
+
+// Draw a new job key from the system CSPRNG (getrandom). Streams written
+// under the previous key can no longer be regenerated. Call while no
+// pass is running; the first keystream use makes a key if none exists.
+void new_job_key();
+
+// Wipe the job key; the next keystream use draws a new one
+void forget_job_key();
+
+// Fill `size` bytes from the system CSPRNG; nonces, keys and anything
+// drawn off the thread that runs the passes
+void system_random(void* buffer, size_t size);
+
+#endif // KEYSTREAM_H
@@ -0,0 +1,395 @@
+// Parallel Digital Shredder - Embedding API
+// C wrappers over run_file_job(); nothing may throw across the boundary.
+// Started jobs run in order on one executor thread, plus a ticker thread
+// while a progress callback is set.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "job.h"
+#include "libshredder.h"
+#include "numa.h"
+#include "pattern.h"
+
+using namespace std;
+
+// Schedule used when the caller sets no pass count of its own
+static const int DEFAULT_PASSES = 3;
+
+struct shredder_job {
+    string path;
+    string spec;                    // profile or schedule; empty = default cycle
+    int passes = 0;
+    bool delete_file = false;
+    JobOptions options;
+
+    shredder_progress_callback callback = nullptr;
+    void* user_data = nullptr;
+    int interval_ms = 1000;
+
+    PassSchedule schedule;          // resolved by shredder_start
+    JobResources resources;
+    atomic<bool> running{false};    // started (queued or running), not finished
+    atomic<bool> finished{false};
+    // Written under done_lock: by the executor together with `finished`,
+    // and by failing calls. Read by the caller once the job has finished.
+    int result = -1;
+    string report;
+    string log;
+    string error;
+
+    mutex done_lock;
+    condition_variable done;        // wakes the ticker and shredder_wait
+    bool settled = false;           // final callback made; the job may be closed
+};
+
+static int fail(shredder_job* job, const string& error) {
+    lock_guard<mutex> guard(job->done_lock);
+    job->error = error;
+    return -1;
+}
+
+// Settings are fixed once the job starts
+static bool configurable(shredder_job* job) {
+    if (job->running || job->finished) {
+        fail(job, "job has already started");
+        return false;
+    }
+    return true;
+}
+
+static bool resolve_schedule(const string& spec, int passes, PassSchedule& schedule, string& error) {
+    if (spec.empty()) {
+        schedule = default_schedule(passes > 0 ? passes : DEFAULT_PASSES);
+        return true;
+    }
+    if (!find_profile(spec.c_str(), schedule) && !parse_schedule(spec.c_str(), schedule)) {
+        error = "unknown profile or invalid schedule " + spec;
+        return false;
+    }
+    if (schedule.crypto_erase && passes > 1) {
+        error = "crypto-erase writes exactly one pass";
+        return false;
+    }
+    fit_schedule(schedule, passes);
+    return true;
+}
+
+extern "C" {
+
+shredder_job* shredder_open(const char* path) {
+    if (!path) {
+        return nullptr;
+    }
+    shredder_job* job = new (nothrow) shredder_job;
+    if (job) {
+        job->path = path;
+    }
+    return job;
+}
+
+void shredder_close(shredder_job* job) {
+    if (!job) {
+        return;
+    }
+    if (job->running || job->finished) {
+        shredder_cancel(job);
+        shredder_wait(job);
+    }
+    delete job;
+}
+
+int shredder_set_schedule(shredder_job* job, const char* spec) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    PassSchedule schedule;
+    string error;
+    if (!spec || !resolve_schedule(spec, job->passes, schedule, error)) {
+        return fail(job, spec ? error : "no schedule given");
+    }
+    job->spec = spec;
+    return 0;
+}
+
+int shredder_set_passes(shredder_job* job, int passes) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    PassSchedule schedule;
+    string error;
+    if (passes < 0 || !resolve_schedule(job->spec, passes, schedule, error)) {
+        return fail(job, (passes < 0) ? "passes must not be negative" : error);
+    }
+    job->passes = passes;
+    return 0;
+}
+
+int shredder_set_backend(shredder_job* job, const char* name) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    if (name && strcmp(name, "auto") == 0) {
+        job->options.backend_set = false;
+    } else if (name && strcmp(name, "pwrite") == 0) {
+        job->options.backend_set = true;
+        job->options.backend = BACKEND_PWRITE;
+    } else if (name && strcmp(name, "mmap") == 0) {
+        job->options.backend_set = true;
+        job->options.backend = BACKEND_MMAP;
+    } else {
+        return fail(job, string("unknown backend ") + (name ? name : ""));
+    }
+    return 0;
+}
+
+int shredder_set_threads(shredder_job* job, int threads) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    if (threads < 0) {
+        return fail(job, "threads must not be negative");
+    }
+    job->options.num_threads = threads;
+    return 0;
+}
+
+int shredder_set_verify(shredder_job* job, int mode) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    switch (mode) {
+    case SHREDDER_VERIFY_OFF:   job->options.verify = VERIFY_OFF; break;
+    case SHREDDER_VERIFY_FINAL: job->options.verify = VERIFY_FINAL; break;
+    case SHREDDER_VERIFY_ALL:   job->options.verify = VERIFY_EVERY_PASS; break;
+    default:
+        return fail(job, "unknown verify mode");
+    }
+    return 0;
+}
+
+int shredder_set_delete(shredder_job* job, int delete_file) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    job->delete_file = (delete_file != 0);
+    return 0;
+}
+
+int shredder_set_progress_callback(shredder_job* job, shredder_progress_callback callback,
+                                   void* user_data, int interval_ms) {
+    if (!configurable(job)) {
+        return -1;
+    }
+    if (interval_ms < 1) {
+        return fail(job, "interval must be at least 1 ms");
+    }
+    job->callback = callback;
+    job->user_data = user_data;
+    job->interval_ms = interval_ms;
+    return 0;
+}
+
+static void notify_progress(shredder_job* job) {
+    shredder_progress progress;
+    shredder_poll(job, &progress);
+    job->callback(&progress, job->user_data);
+}
+
+// Runs one job on the executor thread
+static void execute(shredder_job* job) {
+    thread ticker;
+    if (job->callback) {
+        ticker = thread([job] {
+            unique_lock<mutex> guard(job->done_lock);
+            while (!job->done.wait_for(guard, chrono::milliseconds(job->interval_ms),
+                                       [job] { return job->finished.load(); })) {
+                guard.unlock();
+                notify_progress(job);
+                guard.lock();
+            }
+        });
+    }
+
+    bool ok = false;
+    string error;
+    string report;
+    ostringstream log;
+    try {
+        job->resources.report.reset(new JobReport(""));
+        ok = run_file_job(job->path.c_str(), job->options, job->schedule, job->delete_file,
+                          job->resources, log, error);
+        report = job->resources.report->json();
+    } catch (const exception& exception) {
+        error = exception.what();
+    }
+
+    {
+        lock_guard<mutex> guard(job->done_lock);
+        job->result = ok ? 0 : -1;
+        if (!ok) {
+            job->error = error;
+        }
+        job->report = report;
+        job->log = log.str();
+        job->finished = true;
+        job->running = false;
+    }
+    job->done.notify_all();
+    if (ticker.joinable()) {
+        ticker.join();
+    }
+    if (job->callback) {
+        notify_progress(job);
+    }
+}
+
+// One persistent thread runs every started job, in start order, as the
+// daemon's executor does: OpenMP keeps the worker pool of a master thread
+// (and each pool thread its buffer arena) only while that thread lives.
+// Jobs could not overlap anyway, since the key, worker pool and kernel
+// level are per process.
+class Executor {
+public:
+    ~Executor() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+            if (current) {
+                current->resources.cancel = true;
+            }
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // Throws if the thread cannot be created
+    void submit(shredder_job* job) {
+        lock_guard<mutex> guard(lock);
+        if (!worker.joinable()) {
+            worker = thread(&Executor::run, this);
+        }
+        queue.push_back(job);
+        wake.notify_one();
+    }
+
+private:
+    mutex lock;
+    condition_variable wake;
+    deque<shredder_job*> queue;
+    shredder_job* current = nullptr;
+    bool stopping = false;
+    thread worker;
+
+    void run() {
+        // Embedding processes run job after job on the same threads
+        keep_local_buffers(true);
+
+        unique_lock<mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            current = queue.front();
+            queue.pop_front();
+            guard.unlock();
+
+            execute(current);
+
+            guard.lock();
+            shredder_job* job = current;
+            current = nullptr;
+            // Last touch: shredder_wait may return and the job be closed
+            lock_guard<mutex> done_guard(job->done_lock);
+            job->settled = true;
+            job->done.notify_all();
+        }
+    }
+};
+
+static Executor executor;
+
+int shredder_start(shredder_job* job) {
+    PassSchedule schedule;
+    string error;
+    if (!resolve_schedule(job->spec, job->passes, schedule, error)) {
+        return fail(job, error);
+    }
+    bool idle = false;
+    if (job->finished || !job->running.compare_exchange_strong(idle, true)) {
+        return fail(job, "job has already started");
+    }
+    job->schedule = schedule;
+
+    try {
+        executor.submit(job);
+    } catch (const exception& exception) {
+        job->running = false;
+        return fail(job, exception.what());
+    }
+    return 0;
+}
+
+int shredder_wait(shredder_job* job) {
+    unique_lock<mutex> guard(job->done_lock);
+    if (!job->running && !job->finished) {
+        guard.unlock();
+        return fail(job, "job has not been started");
+    }
+    job->done.wait(guard, [job] { return job->settled; });
+    return job->result;
+}
+
+int shredder_cancel(shredder_job* job) {
+    job->resources.cancel = true;
+    return 0;
+}
+
+int shredder_run(shredder_job* job) {
+    if (shredder_start(job) != 0) {
+        return -1;
+    }
+    return shredder_wait(job);
+}
+
+int shredder_poll(shredder_job* job, shredder_progress* progress) {
+    if (!progress) {
+        return fail(job, "no progress buffer");
+    }
+    const JobProgress& state = job->resources.progress;
+    progress->bytes_written = state.bytes_written;
+    progress->bytes_total = static_cast<long long>(state.file_size) * state.passes;
+    progress->pass = state.pass;
+    progress->passes = state.passes;
+    progress->running = job->running;
+    progress->finished = job->finished;
+    progress->cancelled = job->resources.cancel;
+    return 0;
+}
+
+const char* shredder_report_json(shredder_job* job) {
+    return job->finished ? job->report.c_str() : "";
+}
+
+const char* shredder_log(shredder_job* job) {
+    return job->finished ? job->log.c_str() : "";
+}
+
+const char* shredder_error(shredder_job* job) {
+    // The executor may still publish the job's own failure
+    lock_guard<mutex> guard(job->done_lock);
+    return (job->running && !job->finished) ? "" : job->error.c_str();
+}
+
+}
@@ -0,0 +1,115 @@
+/* Parallel Digital Shredder - Embedding API
+ * C interface to the shredding engine, for linking libshredder.a or
+ * libshredder.so into another process instead of running the tool */
+
+#ifndef LIBSHREDDER_H
+#define LIBSHREDDER_H
+
+/* The library is built with hidden visibility; only these are exported */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define SHREDDER_API __attribute__((visibility("default")))
+#else
+#define SHREDDER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One file to shred: configured, run once (blocking or in the
+ * background), then inspected and closed. Functions returning int give 0
+ * on success and -1 on failure, with the reason in shredder_error(). */
+typedef struct shredder_job shredder_job;
+
+enum shredder_verify {
+    SHREDDER_VERIFY_OFF = 0,
+    SHREDDER_VERIFY_FINAL = 1,      /* read back the last pass */
+    SHREDDER_VERIFY_ALL = 2         /* read back every pass */
+};
+
+typedef struct shredder_progress {
+    long long bytes_written;        /* all passes so far */
+    long long bytes_total;          /* file size times passes; 0 until planned */
+    int pass;                       /* 1-based, 0 = not inside a pass */
+    int passes;
+    int running;                    /* started and not yet finished */
+    int finished;                   /* the final report is ready */
+    int cancelled;                  /* shredder_cancel has been called */
+} shredder_progress;
+
+typedef void (*shredder_progress_callback)(const shredder_progress* progress, void* user_data);
+
+/* NULL if `path` is NULL or memory runs out; the file itself is checked
+ * by shredder_run */
+SHREDDER_API shredder_job* shredder_open(const char* path);
+
+/* A job still running is cancelled and waited for first */
+SHREDDER_API void shredder_close(shredder_job* job);
+
+/* A profile name (dod3, gutmann, crypto-erase, ...) or a schedule such as
+ * "00,ff,rand". Default: the 0x00 / 0xFF / random cycle. */
+SHREDDER_API int shredder_set_schedule(shredder_job* job, const char* spec);
+
+/* Repeat or truncate the schedule to `passes`; 0 = as defined (3 for
+ * the default cycle) */
+SHREDDER_API int shredder_set_passes(shredder_job* job, int passes);
+
+/* "auto", "pwrite" or "mmap" */
+SHREDDER_API int shredder_set_backend(shredder_job* job, const char* name);
+
+/* Worker threads; 0 = chosen from the device */
+SHREDDER_API int shredder_set_threads(shredder_job* job, int threads);
+
+SHREDDER_API int shredder_set_verify(shredder_job* job, int mode);
+
+/* Delete the file once it is shredded (crypto-erase always does) */
+SHREDDER_API int shredder_set_delete(shredder_job* job, int delete_file);
+
+/* Call `callback` every `interval_ms` while the job runs, and once more
+ * after it finishes. It runs on a library thread, never twice at once,
+ * and must return quickly. NULL removes it. */
+SHREDDER_API int shredder_set_progress_callback(shredder_job* job,
+                                                shredder_progress_callback callback,
+                                                void* user_data, int interval_ms);
+
+/* Queue the job and return at once. Jobs in one process run one at a
+ * time, in start order, on a single library thread that lives until the
+ * process exits, since they share the worker pool and the keystream key.
+ * That keeps the worker threads, and their write buffers, for the next
+ * job. Each job runs only once. Warnings and errors also go to stderr,
+ * as in the tool. */
+SHREDDER_API int shredder_start(shredder_job* job);
+
+/* Block until a started job has finished, including its final progress
+ * callback; its result, as for shredder_run */
+SHREDDER_API int shredder_wait(shredder_job* job);
+
+/* Ask the job to stop: writes already issued complete and the file is
+ * flushed, then no further pass runs and the file is not deleted. The
+ * job finishes with -1, shredder_error() "cancelled", and a report with
+ * status "cancelled". Safe from any thread, including callbacks, and
+ * before the job starts. */
+SHREDDER_API int shredder_cancel(shredder_job* job);
+
+/* shredder_start and shredder_wait in one call */
+SHREDDER_API int shredder_run(shredder_job* job);
+
+/* Safe to call from any thread, at any time */
+SHREDDER_API int shredder_poll(shredder_job* job, shredder_progress* progress);
+
+/* Once finished ("" before): the job report as JSON (same form as --report).
+ * The strings below stay valid until shredder_close. */
+SHREDDER_API const char* shredder_report_json(shredder_job* job);
+
+/* Once finished: what the tool would have printed to stdout */
+SHREDDER_API const char* shredder_log(shredder_job* job);
+
+/* Reason for the last failure, or "". Always "" while a started job has
+ * not finished: the job's own failure is published when it finishes. */
+SHREDDER_API const char* shredder_error(shredder_job* job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBSHREDDER_H */
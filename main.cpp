@@ -1,236 +1,919 @@
 // Demonstrates: Shared-memory parallelism, data parallelism, OpenMP work-sharing, thread synchronization
 
 #include <iostream>
+#include <algorithm>
 #include <fstream>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <chrono>
 #include <iomanip>
 #include <thread>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <csignal>
+#include <sys/stat.h>
 #include <omp.h>
 #include "shredder.h"
+#include "cpu.h"
+#include "numa.h"
+#include "throttle.h"
+#include "topology.h"
+#include "strategy.h"
+#include "engine.h"
+#include "keystream.h"
+#include "pattern.h"
+#include "cow.h"
+#include "delete.h"
+#include "freespace.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "report.h"
+#include "daemon.h"
+#include "devqueue.h"
+#include "job.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 using namespace std;
 
-// Forward declarations from utils.cpp
-long get_file_size(FILE* file);
-bool validate_file(const char* path);
-void print_warning();
-void print_banner();
-bool get_user_confirmation();
-bool get_deletion_confirmation();
-bool is_ssd(const char* path);
-bool secure_delete_file(const char* path, bool is_ssd_device, long file_size);
-
-// External progress tracking variables
-extern volatile long total_bytes_processed;
-extern long total_bytes_to_process;
-extern int current_pass;
-extern int total_passes;
+// Command-line settings; positional arguments plus --options. The
+// engine settings come from JobOptions.
+struct CliOptions : JobOptions {
+    const char* file_path = nullptr;
+    const char* batch_list = nullptr;   // file of paths; replaces file_path
+    const char* free_space_dir = nullptr;   // wipe free space; replaces file_path
+    const char* daemon_socket = nullptr;    // serve jobs; replaces file_path
+    long reserve = 64L * 1024 * 1024;   // bytes left free by --free-space
+    int passes = 0;                 // 0 = length of the chosen schedule
+    const char* profile = nullptr;
+    const char* schedule = nullptr;
+    bool stats = false;
+    double stats_interval = 0.0;    // seconds between interim tables, 0 = end only
+    const char* metrics_file = nullptr;
+    double metrics_interval = 10.0;
+    const char* report_file = nullptr;
+    int per_device = 0;             // batch files in flight per device, 0 = by class
+    bool isa_set = false;
+    IsaLevel isa = ISA_SCALAR;
+};
+
+static void print_usage(const char* prog) {
+    cerr << "\nUsage: " << prog << " [options] <file_path> <passes> [threads]\n";
+    cerr << "       " << prog << " [options] --profile=NAME <file_path> [passes] [threads]\n";
+    cerr << "       " << prog << " [options] --batch=LIST <passes> [threads]\n";
+    cerr << "       " << prog << " [options] --free-space=DIR <passes> [threads]\n";
+    cerr << "       " << prog << " [options] --daemon=SOCKET <passes> [threads]\n\n";
+    cerr << "Arguments:\n";
+    cerr << "  file_path    Target file to shred\n";
+    cerr << "  passes       Number of overwrite passes (min: 1); with a profile or\n";
+    cerr << "               schedule it repeats or truncates it (0 = as defined)\n";
+    cerr << "  threads      Number of threads (optional, default: auto)\n\n";
+    cerr << "Options:\n";
+    cerr << "  --profile=NAME\n";
+    cerr << "               Standard pattern schedule:\n";
+    vector<string> profiles;
+    list_profiles(profiles);
+    for (const auto& line : profiles) {
+        cerr << "                 " << line << "\n";
+    }
+    cerr << "  --schedule=LIST\n";
+    cerr << "               Custom passes, e.g. 00,ff,rand,92:49:24\n";
+    cerr << "  --threads=N  Same as the threads argument\n";
+    cerr << "  --batch=LIST Shred every path listed in LIST (one per line), deleting\n";
+    cerr << "               finished files while the next one is overwritten\n";
+    cerr << "  --per-device=N\n";
+    cerr << "               Batch files shredded at once per device (default: 1 on\n";
+    cerr << "               disks, more on SSDs); devices always run in parallel\n";
+    cerr << "  --obfuscate  Rename files to random names before deleting them\n";
+    cerr << "  --free-space=DIR\n";
+    cerr << "               Overwrite the unallocated space of the filesystem holding DIR\n";
+    cerr << "  --daemon=SOCKET\n";
+    cerr << "               Serve shred jobs on a Unix socket until SHUTDOWN or SIGTERM;\n";
+    cerr << "               the passes and options given here are the job defaults\n";
+    cerr << "  --reserve=SIZE\n";
+    cerr << "               Space --free-space leaves free for other writers (default: 64M)\n";
+    cerr << "  --coalesce   On SSD, tmpfs, copy-on-write and log-structured targets,\n";
+    cerr << "               write only the final pass and discard on deletion\n";
+    cerr << "  --keep-passes\n";
+    cerr << "               Run every pass even when copy-on-write would relocate them\n";
+    cerr << "  --numa       Pin workers to cores and keep buffers node-local,\n";
+    cerr << "               starting on the node closest to the storage controller\n";
+    cerr << "  --rate=MB    Cap write throughput at MB per second\n";
+    cerr << "  --iops=N     Cap write operations per second\n";
+    cerr << "  --target-latency=MS\n";
+    cerr << "               Lower the --rate cap while writes take longer than MS\n";
+    cerr << "  --stats[=SECONDS]\n";
+    cerr << "               Print fill/wait/write/flush/trim latencies at the end,\n";
+    cerr << "               and every SECONDS while running\n";
+    cerr << "  --metrics-file=PATH\n";
+    cerr << "               Keep Prometheus metrics for the job in PATH (textfile format)\n";
+    cerr << "  --metrics-interval=SECONDS\n";
+    cerr << "               Seconds between metrics file updates (default 10)\n";
+    cerr << "  --verify[=all]\n";
+    cerr << "               Read the file back after the final pass (or every pass)\n";
+    cerr << "               and compare it with the pattern written\n";
+    cerr << "  --report=FILE\n";
+    cerr << "               Write per-file timings and strategy to FILE (.json or .csv)\n";
+    cerr << "  --low-priority\n";
+    cerr << "               Run with idle I/O class and lowest CPU priority\n";
+    cerr << "  --device-class=CLASS\n";
+    cerr << "               Override detection: hdd, sata-ssd, nvme, memory, network, unknown\n";
+    cerr << "  --unit=SIZE  Bytes per write (e.g. 512K, 4M)\n";
+    cerr << "  --isa=NAME   Kernel instruction set: auto (default), scalar, sse2, avx2\n";
+    cerr << "               or avx512; for benchmarking\n";
+    cerr << "  --backend=NAME\n";
+    cerr << "               auto (default: mmap up to 8M), mmap or pwrite\n";
+    cerr << "  --direct     Force O_DIRECT writes\n";
+    cerr << "  --buffered   Force page-cache writes\n";
+    cerr << "  --sequential One writer streams the file, other threads generate data\n";
+    cerr << "  --chunked    Each thread writes its own contiguous chunk\n";
+    cerr << "  --pipelined[=WRITERS]\n";
+    cerr << "               Generator threads feed WRITERS writer threads\n\n";
+    cerr << "Examples:\n";
+    cerr << "  " << prog << " secret.txt 3\n";
+    cerr << "  " << prog << " document.pdf 7 4\n";
+    cerr << "  " << prog << " --profile=gutmann disk.img\n";
+    cerr << "  " << prog << " --batch=files.txt --obfuscate 3\n";
+    cerr << "  " << prog << " --numa archive.tar 3 16\n";
+    cerr << "  " << prog << " --rate=50 --low-priority db_dump.sql 3\n\n";
+}
+
+// A number above zero with nothing after it; "50M" or a typo is rejected
+// rather than read as 0, which would turn the limit off
+static bool parse_positive(const char* text, const char* option, double& value) {
+    char* end;
+    errno = 0;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !(parsed > 0)) {
+        cerr << "Error: " << option << " needs a positive number, got \"" << text << "\"\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+static bool parse_args(int argc, char* argv[], CliOptions& options) {
+    const char* positional[3];
+    int positional_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            if (positional_count == 3) {
+                return false;
+            }
+            positional[positional_count++] = arg;
+        } else if (strncmp(arg, "--profile=", 10) == 0) {
+            options.profile = arg + 10;
+        } else if (strncmp(arg, "--schedule=", 11) == 0) {
+            options.schedule = arg + 11;
+        } else if (strncmp(arg, "--batch=", 8) == 0) {
+            options.batch_list = arg + 8;
+        } else if (strncmp(arg, "--free-space=", 13) == 0) {
+            options.free_space_dir = arg + 13;
+        } else if (strncmp(arg, "--reserve=", 10) == 0) {
+            options.reserve = parse_size(arg + 10);
+            if (options.reserve < 0) {
+                cerr << "Error: Invalid --reserve size\n";
+                return false;
+            }
+        } else if (strcmp(arg, "--obfuscate") == 0) {
+            options.obfuscate = true;
+        } else if (strcmp(arg, "--coalesce") == 0) {
+            options.coalesce = true;
+        } else if (strcmp(arg, "--keep-passes") == 0) {
+            options.keep_passes = true;
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            options.num_threads = atoi(arg + 10);
+            if (options.num_threads < 1) {
+                options.num_threads = -1;
+            }
+        } else if (strcmp(arg, "--numa") == 0) {
+            options.numa = true;
+        } else if (strncmp(arg, "--rate=", 7) == 0) {
+            if (!parse_positive(arg + 7, "--rate", options.rate_mb)) {
+                return false;
+            }
+        } else if (strncmp(arg, "--iops=", 7) == 0) {
+            if (!parse_positive(arg + 7, "--iops", options.iops)) {
+                return false;
+            }
+        } else if (strncmp(arg, "--target-latency=", 17) == 0) {
+            if (!parse_positive(arg + 17, "--target-latency", options.target_latency_ms)) {
+                return false;
+            }
+        } else if (strncmp(arg, "--stats", 7) == 0 && (arg[7] == '\0' || arg[7] == '=')) {
+            options.stats = true;
+            if (arg[7] == '=') {
+                options.stats_interval = atof(arg + 8);
+                if (options.stats_interval <= 0) {
+                    cerr << "Error: --stats interval must be positive\n";
+                    return false;
+                }
+            }
+        } else if (strncmp(arg, "--metrics-file=", 15) == 0) {
+            options.metrics_file = arg + 15;
+        } else if (strncmp(arg, "--metrics-interval=", 19) == 0) {
+            options.metrics_interval = atof(arg + 19);
+            if (options.metrics_interval <= 0) {
+                cerr << "Error: --metrics-interval must be positive\n";
+                return false;
+            }
+        } else if (strncmp(arg, "--per-device=", 13) == 0) {
+            options.per_device = atoi(arg + 13);
+            if (options.per_device < 1) {
+                cerr << "Error: --per-device must be at least 1\n";
+                return false;
+            }
+        } else if (strncmp(arg, "--daemon=", 9) == 0) {
+            options.daemon_socket = arg + 9;
+        } else if (strcmp(arg, "--verify") == 0) {
+            options.verify = VERIFY_FINAL;
+        } else if (strcmp(arg, "--verify=all") == 0) {
+            options.verify = VERIFY_EVERY_PASS;
+        } else if (strncmp(arg, "--report=", 9) == 0) {
+            options.report_file = arg + 9;
+        } else if (strcmp(arg, "--low-priority") == 0) {
+            options.low_priority = true;
+        } else if (strncmp(arg, "--device-class=", 15) == 0) {
+            if (!parse_device_class(arg + 15, options.device_class)) {
+                cerr << "Error: Unknown device class " << (arg + 15) << "\n";
+                return false;
+            }
+            options.device_class_set = true;
+        } else if (strncmp(arg, "--unit=", 7) == 0) {
+            options.unit_size = parse_size(arg + 7);
+            if (options.unit_size < 4096 || options.unit_size % 4096 != 0) {
+                cerr << "Error: --unit must be a multiple of 4K\n";
+                return false;
+            }
+        } else if (strncmp(arg, "--isa=", 6) == 0) {
+            const char* name = arg + 6;
+            options.isa_set = (strcmp(name, "auto") != 0);
+            if (options.isa_set && !parse_isa(name, options.isa)) {
+                cerr << "Error: Unknown instruction set " << name << "\n";
+                return false;
+            }
+        } else if (strncmp(arg, "--backend=", 10) == 0) {
+            const char* name = arg + 10;
+            options.backend_set = (strcmp(name, "auto") != 0);
+            if (strcmp(name, "mmap") == 0) {
+                options.backend = BACKEND_MMAP;
+            } else if (strcmp(name, "pwrite") == 0) {
+                options.backend = BACKEND_PWRITE;
+            } else if (options.backend_set) {
+                cerr << "Error: Unknown backend " << name << "\n";
+                return false;
+            }
+        } else if (strcmp(arg, "--direct") == 0) {
+            options.direct_io = 1;
+        } else if (strcmp(arg, "--buffered") == 0) {
+            options.direct_io = 0;
+        } else if (strcmp(arg, "--sequential") == 0) {
+            options.pipeline = PIPELINE_SEQUENTIAL;
+            options.pipeline_set = true;
+        } else if (strcmp(arg, "--chunked") == 0) {
+            options.pipeline = PIPELINE_CHUNKED;
+            options.pipeline_set = true;
+        } else if (strncmp(arg, "--pipelined", 11) == 0 &&
+                   (arg[11] == '\0' || arg[11] == '=')) {
+            options.pipeline = PIPELINE_OVERLAPPED;
+            options.pipeline_set = true;
+            if (arg[11] == '=') {
+                options.writers = atoi(arg + 12);
+                if (options.writers < 1) {
+                    cerr << "Error: --pipelined needs at least 1 writer\n";
+                    return false;
+                }
+            }
+        } else {
+            cerr << "Error: Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+
+    if ((options.batch_list != nullptr) + (options.free_space_dir != nullptr) +
+        (options.daemon_socket != nullptr) > 1) {
+        cerr << "Error: Use only one of --batch, --free-space and --daemon\n";
+        return false;
+    }
+
+    // A profile or schedule defines its own pass count; a batch list,
+    // free-space directory or daemon socket takes the place of the file path
+    bool has_schedule = options.profile || options.schedule;
+    int first = (options.batch_list || options.free_space_dir || options.daemon_socket) ? 0 : 1;
+    if (positional_count < first + (has_schedule ? 0 : 1) || positional_count > first + 2) {
+        return false;
+    }
+
+    if (first == 1) {
+        options.file_path = positional[0];
+    }
+    if (positional_count >= first + 1) {
+        options.passes = atoi(positional[first]);
+        if (options.passes < (has_schedule ? 0 : 1)) {
+            options.passes = -1;
+        }
+    }
+    // 0 = let the I/O strategy choose
+    if (positional_count == first + 2) {
+        options.num_threads = atoi(positional[first + 1]);
+        if (options.num_threads < 1) {
+            options.num_threads = -1;
+        }
+    }
+    return true;
+}
+
+
+static DeviceClass queue_class(const DeviceQueue& queue, const vector<string>& batch,
+                               const CliOptions& options) {
+    const char* first = batch[queue.items.front()].c_str();
+    return options.device_class_set ? options.device_class
+        : classify_device(storage_info(first), is_ssd(first));
+}
+
+// Files on different devices run side by side; on one device only as
+// many as its class tolerates (one for a spinning disk)
+static vector<DeviceQueue> plan_device_queues(const vector<string>& batch, const CliOptions& options) {
+    vector<DeviceQueue> queues = group_by_device(batch);
+    for (DeviceQueue& queue : queues) {
+        if (queue.disks.empty()) {
+            continue;
+        }
+        queue.limit = (options.per_device > 0) ? options.per_device
+            : device_concurrency(queue_class(queue, batch, options));
+        queue.limit = min(queue.limit, static_cast<int>(queue.items.size()));
+    }
+    return queues;
+}
+
+// Fill the free space of the filesystem holding options.free_space_dir,
+// run the schedule over the fill files and release them with a discard
+static int wipe_free_space(const CliOptions& options, const PassSchedule& schedule,
+                           JobResources& job) {
+    const char* dir = options.free_space_dir;
+
+    cout << "\nValidating " << dir << " ...\n";
+
+    struct stat dir_stat;
+    if (stat(dir, &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode)) {
+        cerr << "Error: Not a directory: " << dir << "\n";
+        return 1;
+    }
+
+    ShredTarget base;
+    detect_storage(dir, base, cout);
+
+    char free_buffer[50], reserve_buffer[50];
+    format_bytes(max(available_space(dir), 0L), free_buffer, sizeof(free_buffer));
+    format_bytes(options.reserve, reserve_buffer, sizeof(reserve_buffer));
+    cout << "  + Free: " << free_buffer << " (" << reserve_buffer << " kept in reserve)\n";
+
+    cout << "\nWARNING: This will fill the free space of the filesystem holding " << dir << "\n";
+    cout << "         Other writers may see it full until the wipe completes\n";
+    cout << "\nContinue? (y/n): ";
+
+    if (!get_user_confirmation()) {
+        cout << "\nOperation cancelled\n";
+        return 0;
+    }
+
+    if (options.low_priority && !set_low_io_priority()) {
+        cerr << "Warning: Could not lower I/O priority\n";
+    }
+
+    long claimable = max(available_space(dir) - options.reserve, 0L);
+    vector<FillFile> files;
+    if (!create_fill_files(dir, options.reserve, files)) {
+        job.progress.setup_errors++;
+        return 1;
+    }
+    job.progress.files_total = static_cast<int>(files.size());
+
+    long claimed = 0;
+    for (const FillFile& file : files) {
+        claimed += file.size;
+    }
+    char claimed_buffer[50], claimable_buffer[50];
+    format_bytes(claimed, claimed_buffer, sizeof(claimed_buffer));
+    format_bytes(claimable, claimable_buffer, sizeof(claimable_buffer));
+    cout << "\nPreallocated " << files.size() << " fill file" << (files.size() > 1 ? "s" : "")
+         << " (" << claimed_buffer << " of " << claimable_buffer << " free above the reserve)\n";
+
+    // Whatever is still free above the reserve is never overwritten
+    long unclaimed = available_space(dir) - options.reserve;
+    if (unclaimed >= FILL_FILE_MIN) {
+        char unclaimed_buffer[50];
+        format_bytes(unclaimed, unclaimed_buffer, sizeof(unclaimed_buffer));
+        cerr << "Warning: " << unclaimed_buffer << " of free space could not be claimed"
+             << " and will not be wiped\n";
+    }
+
+    // Keep going after a failure: the fill files must be removed regardless
+    bool all_ok = true;
+    for (const FillFile& file : files) {
+        ShredTarget target = base;
+        target.path = file.path.c_str();
+        target.preallocated = true;
+        target.cow.free_bytes = available_space(dir);
+
+        cout << "\n" << file.path << "\n";
+        if (!shred_target(target, options, schedule, job, cout)) {
+            all_ok = false;
+        }
+        report_file(job, target.report);
+    }
+
+    cout << "\nReleasing fill files...\n";
+    if (schedule.crypto_erase) {
+        discard_job_key(cout);
+    }
+
+    DeletePipeline deleter(false, job.stats.get());
+    vector<string> submitted;
+    for (const FillFile& file : files) {
+        deleter.submit(file.path, file.size, true);
+        submitted.push_back(file.path);
+    }
+    vector<string> undeleted = deleter.finish();
+    job.progress.delete_errors += undeleted.size();
+    report_deletes(job, deleter, submitted);
+
+    for (const string& path : undeleted) {
+        cerr << "Error: Failed to delete fill file: " << path << "\n";
+    }
+    if (undeleted.empty()) {
+        cout << "  + Fill files removed\n";
+    }
+    auto trim_start = chrono::steady_clock::now();
+    bool trimmed = trim_free_space(dir);
+    if (job.stats) {
+        job.stats->worker(0).stages[STAGE_TRIM].record(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - trim_start).count());
+    }
+    if (trimmed) {
+        cout << "  + Free space discarded (FITRIM)\n";
+    } else {
+        cout << "  ! Free space not discarded (FITRIM needs root and device support)\n";
+    }
+    cout << "\n";
+
+    return (all_ok && undeleted.empty()) ? 0 : 1;
+}
+
+// Interim tables while the job runs and the final table on every exit path
+class StatsPrinter {
+public:
+    StatsPrinter(const JobStats* stats, double interval_sec) : stats(stats) {
+        if (stats && interval_sec > 0) {
+            reporter.reset(new StatsReporter(*stats, interval_sec));
+        }
+    }
+
+    ~StatsPrinter() {
+        reporter.reset();
+        if (!stats) {
+            return;
+        }
+        StageHistograms merged;
+        stats->snapshot(merged);
+        if (merged.stages[STAGE_WRITE].count() > 0 || merged.stages[STAGE_FILL].count() > 0) {
+            cout << "Latency by stage:\n";
+            print_stage_table(merged, cout);
+            cout << "\n";
+        }
+    }
+
+private:
+    const JobStats* stats;
+    unique_ptr<StatsReporter> reporter;
+};
+
+// One job from the daemon socket: the daemon's options with the job's
+// schedule and delete choice, and no prompts
+static bool run_daemon_job(const DaemonJob& request, const CliOptions& options,
+                           const PassSchedule& defaults, JobResources& job, string& message) {
+    PassSchedule schedule = defaults;
+    if (!request.profile.empty()) {
+        if (!find_profile(request.profile.c_str(), schedule)) {
+            message = "unknown profile " + request.profile;
+            job.progress.setup_errors++;
+            return false;
+        }
+        fit_schedule(schedule, request.passes);
+    } else if (request.passes > 0) {
+        if (options.profile || options.schedule) {
+            fit_schedule(schedule, request.passes);
+        } else {
+            schedule = default_schedule(request.passes);
+        }
+    }
+    if (schedule.crypto_erase && request.passes > 1) {
+        message = "crypto-erase writes exactly one pass";
+        job.progress.setup_errors++;
+        return false;
+    }
+
+    cout << "\n[job " << request.id << "] " << request.path << "\n";
+    return run_file_job(request.path.c_str(), options, schedule, request.delete_file,
+                        job, cout, message);
+}
+
+// The job the first SIGINT/SIGTERM cancels
+static atomic<bool>* interrupt_cancel = nullptr;
+
+static void on_interrupt(int) {
+    if (interrupt_cancel) {
+        interrupt_cancel->store(true);
+    }
+#ifndef _WIN32
+    static const char message[] =
+        "\nCancelling: finishing in-flight writes (press Ctrl-C again to abort)\n";
+    ssize_t ignored = write(STDERR_FILENO, message, sizeof(message) - 1);
+    (void)ignored;
+#endif
+}
+
+// First signal: graceful cancel, so the pass in progress is flushed and
+// the report is still written. The handler then resets, and a second
+// signal kills the process as before.
+static void catch_interrupts(JobResources& job) {
+    interrupt_cancel = &job.cancel;
+#ifdef _WIN32
+    signal(SIGINT, on_interrupt);
+    signal(SIGTERM, on_interrupt);
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_interrupt;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+#endif
+}
+
+// Writes the job report, if any, when main returns
+class ReportWriter {
+public:
+    explicit ReportWriter(const JobReport* report) : report(report) {}
+
+    ~ReportWriter() {
+        if (report) {
+            report->write();
+        }
+    }
+
+private:
+    const JobReport* report;
+};
+
+// Paths listed one per line; blank lines and '#' comments are skipped
+static bool read_batch_list(const char* list_path, vector<string>& paths) {
+    ifstream list(list_path);
+    if (!list) {
+        return false;
+    }
+
+    string line;
+    while (getline(list, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#') {
+            paths.push_back(line);
+        }
+    }
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 3 || argc > 4) {
-        cerr << "\nUsage: " << argv[0] << " <file_path> <passes> [threads]\n\n";
-        cerr << "Arguments:\n";
-        cerr << "  file_path    Target file to shred\n";
-        cerr << "  passes       Number of overwrite passes (min: 1)\n";
-        cerr << "  threads      Number of threads (optional, default: auto)\n\n";
-        cerr << "Examples:\n";
-        cerr << "  " << argv[0] << " secret.txt 3\n";
-        cerr << "  " << argv[0] << " document.pdf 7 4\n\n";
+    CliOptions options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
         return 1;
     }
 
     print_banner();
 
-    const char* file_path = argv[1];
-    int passes = atoi(argv[2]);
-    int num_threads = (argc == 4) ? atoi(argv[3]) : omp_get_max_threads();
-
-    if (passes < 1) {
+    if (options.passes < 0) {
         cerr << "Error: Number of passes must be at least 1\n";
         return 1;
     }
 
-    if (num_threads < 1) {
+    PassSchedule schedule;
+    if (options.profile && options.schedule) {
+        cerr << "Error: Use either --profile or --schedule\n";
+        return 1;
+    } else if (options.profile) {
+        if (!find_profile(options.profile, schedule)) {
+            cerr << "Error: Unknown profile " << options.profile << "\n";
+            return 1;
+        }
+        fit_schedule(schedule, options.passes);
+    } else if (options.schedule) {
+        if (!parse_schedule(options.schedule, schedule)) {
+            cerr << "Error: Invalid schedule " << options.schedule << "\n";
+            return 1;
+        }
+        fit_schedule(schedule, options.passes);
+    } else {
+        schedule = default_schedule(options.passes);
+    }
+    if (schedule.crypto_erase && options.passes > 1) {
+        cerr << "Error: crypto-erase writes exactly one pass\n";
+        return 1;
+    }
+
+    if (options.num_threads < 0) {
         cerr << "Error: Number of threads must be at least 1\n";
         return 1;
     }
 
-    cout << "\nValidating " << file_path << " ...\n";
+    // Every kernel table is indexed by this from here on
+    if (options.isa_set && !select_isa(options.isa)) {
+        cerr << "Error: This CPU does not support " << isa_name(options.isa)
+             << " (best: " << isa_name(detected_isa()) << ")\n";
+        return 1;
+    }
 
-    if (!validate_file(file_path)) {
-        cerr << "Error: File validation failed\n";
+    if (options.target_latency_ms > 0 && options.rate_mb <= 0) {
+        cerr << "Error: --target-latency needs a --rate cap to adapt\n";
         return 1;
     }
-    
-    cout << "  + File OK\n";
 
-    cout << "  + File OK\n";
+    vector<string> batch;
+    if (options.batch_list) {
+        if (!read_batch_list(options.batch_list, batch)) {
+            cerr << "Error: Cannot read batch list " << options.batch_list << "\n";
+            return 1;
+        }
+        if (batch.empty()) {
+            cerr << "Error: Batch list " << options.batch_list << " is empty\n";
+            return 1;
+        }
+    }
+    vector<DeviceQueue> queues = plan_device_queues(batch, options);
+
+    // One key for every random pass of the job; per-pass nonces keep the
+    // streams apart
+    new_job_key();
 
-    // Detect if the storage device is an SSD
-    bool is_ssd_device = is_ssd(file_path);
-    if (is_ssd_device) {
-        cout << "  + Storage: SSD detected (TRIM will be used)\n";
-    } else {
-        cout << "  + Storage: HDD/Standard\n";
+    JobResources job;
+    if (options.rate_mb > 0 || options.iops > 0) {
+        job.limiter.reset(new RateLimiter(options.rate_mb * 1024 * 1024, options.iops,
+                                          options.target_latency_ms / 1000.0));
+    }
+    // One slot per possible OpenMP worker of every file that can run at
+    // once; their teams number their threads from 0 independently
+    int team_slots = max(omp_get_max_threads(), options.num_threads);
+    if (options.stats || options.metrics_file) {
+        job.stats.reset(new JobStats(team_slots * max(queue_slots(queues), 1)));
+    }
+
+    // Final table printed on every return from here, after the last delete
+    StatsPrinter stats_printer(options.stats ? job.stats.get() : nullptr, options.stats_interval);
+
+    // Likewise the final snapshot, with shredder_job_running 0
+    unique_ptr<MetricsExporter> metrics;
+    if (options.metrics_file) {
+        metrics.reset(new MetricsExporter(options.metrics_file, options.metrics_interval,
+                                          job.progress, job.stats.get()));
+    }
+
+    // And the report file
+    if (options.report_file) {
+        job.report.reset(new JobReport(options.report_file));
+    }
+    ReportWriter report_writer(job.report.get());
+
+    // Jobs arrive over the socket; buffers are kept between them
+    if (options.daemon_socket) {
+        if (options.low_priority && !set_low_io_priority()) {
+            cerr << "Warning: Could not lower I/O priority\n";
+        }
+        keep_local_buffers(true);
+        bool served = run_daemon(options.daemon_socket,
+                                 [&](const DaemonJob& request, string& message) {
+            return run_daemon_job(request, options, schedule, job, message);
+        });
+        keep_local_buffers(false);
+        return served ? 0 : 1;
+    }
+
+    // The daemon has its own shutdown handling; every other mode stops
+    // gracefully on the first Ctrl-C
+    catch_interrupts(job);
+
+    if (options.free_space_dir) {
+        return wipe_free_space(options, schedule, job);
+    }
+
+    if (!options.batch_list) {
+        job.progress.files_total = 1;
+        ShredTarget target;
+        if (!inspect_target(options.file_path, target, cout)) {
+            job.progress.setup_errors++;
+            report_file(job, target.report);
+            return 1;
+        }
+
+        print_warning();
+        if (schedule.crypto_erase) {
+            cout << "         Crypto-erase deletes the file after the pass\n";
+        }
+        cout << "\nContinue? (y/n): ";
+
+        if (!get_user_confirmation()) {
+            cout << "\nOperation cancelled\n";
+            return 0;
+        }
+
+        if (options.low_priority && !set_low_io_priority()) {
+            cerr << "Warning: Could not lower I/O priority\n";
+        }
+
+        bool shredded = shred_target(target, options, schedule, job, cout);
+        report_file(job, target.report);
+        if (schedule.crypto_erase) {
+            discard_job_key(cout);
+        }
+        if (!shredded) {
+            return 1;
+        }
+
+        if (!schedule.crypto_erase) {
+            cout << "\nDelete file? (y/n): ";
+
+            if (!get_deletion_confirmation()) {
+                cout << "\nFile kept (overwritten data remains on disk)\n\n";
+                return 0;
+            }
+        }
+
+        // Perform secure deletion and space freeing
+        cout << "\nDeleting...\n";
+
+        DeletePipeline deleter(options.obfuscate, job.stats.get());
+        deleter.submit(target.path, target.file_size, target.use_trim);
+
+        bool deleted = deleter.finish().empty();
+        report_deletes(job, deleter, vector<string>(1, target.path));
+        if (deleted) {
+            cout << "  + File deleted successfully\n";
+            if (target.use_trim) {
+                cout << "  + TRIM issued (device will free blocks)\n";
+            }
+        } else {
+            job.progress.delete_errors++;
+            cerr << "Error: Failed to delete file: " << target.path << "\n";
+            cout << "  ! Deletion failed (manual removal may be needed)\n";
+        }
+
+        cout << "\n";
+
+        return 0;
     }
 
+    // Batch mode asks both questions up front so the job runs unattended
+    cout << "\nBatch: " << batch.size() << " file" << (batch.size() > 1 ? "s" : "")
+         << " from " << options.batch_list << "\n";
     print_warning();
+    if (schedule.crypto_erase) {
+        cout << "         Crypto-erase deletes each file after its pass\n";
+    }
     cout << "\nContinue? (y/n): ";
-    
+
     if (!get_user_confirmation()) {
         cout << "\nOperation cancelled\n";
         return 0;
     }
 
-    // Shared FILE* among threads - each thread uses fseek() before writing
-    FILE* file = fopen(file_path, "rb+");
-    if (!file) {
-        cerr << "\nError: Cannot open file for writing\n";
-        return 1;
+    bool delete_files = true;
+    if (!schedule.crypto_erase) {
+        cout << "\nDelete files after shredding? (y/n): ";
+        delete_files = get_deletion_confirmation();
     }
 
-    long file_size = get_file_size(file);
-    if (file_size <= 0) {
-        cerr << "\nError: Invalid file size\n";
-        fclose(file);
-        return 1;
+    if (options.low_priority && !set_low_io_priority()) {
+        cerr << "Warning: Could not lower I/O priority\n";
     }
 
-    // Data parallelism: divide file into equal chunks
-    long chunk_size = file_size / num_threads;
-    long remainder = file_size % num_threads;
-    
-    char size_buffer[50];
-    format_bytes(file_size, size_buffer, sizeof(size_buffer));
-
-    cout << "\nConfiguration:\n";
-    cout << "  Size: " << size_buffer << " | Passes: " << passes << " | Threads: " << num_threads << "\n";
-    cout << "\nShredding...\n";
-
-    // Initialize progress tracking
-    total_bytes_to_process = file_size;
-    total_passes = passes;
-
-    omp_set_num_threads(num_threads);
+    job.progress.files_total = static_cast<int>(batch.size());
     auto start_time = chrono::high_resolution_clock::now();
 
-    // Progress monitoring in separate section
-    for (int pass = 1; pass <= passes; pass++) {
-        current_pass = pass;
-        total_bytes_processed = 0;
-        
-        const char* pattern_name;
-        if ((pass - 1) % 3 == 0) pattern_name = "0x00";
-        else if ((pass - 1) % 3 == 1) pattern_name = "0xFF";
-        else pattern_name = "rand";
-
-        // OpenMP parallel region: each thread processes its chunk
-        #pragma omp parallel for schedule(static)
-        for (int tid = 0; tid < num_threads; tid++) {
-            long start_offset = tid * chunk_size;
-            long current_chunk_size = chunk_size;
-            
-            if (tid == num_threads - 1) {
-                current_chunk_size += remainder;
-            }
-
-            // Process one pass
-            const long BUFFER_SIZE = 1024 * 1024; // 1 MB
-            unsigned char* buffer = new unsigned char[BUFFER_SIZE];
-            
-            if (!buffer) continue;
-
-            unsigned char pattern;
-            bool use_random = false;
-            
-            if ((pass - 1) % 3 == 0) {
-                pattern = 0x00;
-            } else if ((pass - 1) % 3 == 1) {
-                pattern = 0xFF;
-            } else {
-                use_random = true;
-            }
-
-            long bytes_remaining = current_chunk_size;
-            long current_offset = start_offset;
-
-            while (bytes_remaining > 0) {
-                long bytes_to_write = (bytes_remaining < BUFFER_SIZE) ? 
-                                       bytes_remaining : BUFFER_SIZE;
-
-                if (use_random) {
-                    fill_random_bytes(buffer, bytes_to_write);
-                } else {
-                    memset(buffer, pattern, bytes_to_write);
-                }
+    int slots = queue_slots(queues);
+    cout << "\nDevices: " << queues.size() << "\n";
+    for (const DeviceQueue& queue : queues) {
+        if (queue.disks.empty()) {
+            cout << "  not found: " << queue.items.size() << " file"
+                 << (queue.items.size() > 1 ? "s" : "") << "\n";
+            continue;
+        }
+        const StorageInfo& storage = storage_info(batch[queue.items.front()].c_str());
+        cout << "  " << (storage.device.empty() ? storage.fs_type : storage.device);
+        // LVs, RAID sets and image files also name the disks they share
+        if (!storage.disks.empty() && queue.disks != vector<string>(1, storage.device)) {
+            cout << " on";
+            for (size_t d = 0; d < queue.disks.size(); d++) {
+                cout << (d ? "," : " ") << queue.disks[d];
+            }
+        }
+        cout << " (" << device_class_name(queue_class(queue, batch, options)) << "): "
+             << queue.items.size()
+             << " file" << (queue.items.size() > 1 ? "s" : "") << ", " << queue.limit
+             << " at a time\n";
+    }
 
-                if (fseek(file, current_offset, SEEK_SET) != 0) {
-                    delete[] buffer;
-                    break;
-                }
+    // Deletion of one file overlaps the overwrite passes of the next
+    DeletePipeline deleter(options.obfuscate, job.stats.get());
+    int shredded = 0;
+    vector<char> file_ok(batch.size(), 0);
+    vector<string> submitted;
+    mutex batch_lock;   // output, report and delete submissions
+
+    // With several files in flight, each file's output is printed in one
+    // block once it is done
+    int cpu_budget = (options.num_threads > 0) ? options.num_threads : omp_get_max_threads();
+    run_device_queues(queues, cpu_budget, [&](size_t i, int slot, int cpu_share) {
+        const char* path = batch[i].c_str();
+        ostringstream buffered;
+        ostream& out = (slots > 1) ? static_cast<ostream&>(buffered) : cout;
+        out << "\n[" << (i + 1) << "/" << batch.size() << "] " << path << "\n";
+
+        ShredTarget target;
+        target.cpu_share = (slots > 1) ? cpu_share : 0;
+        // Concurrent files record into their own histograms and, with
+        // --numa, start on their own share of the CPUs
+        target.worker_base = slot * team_slots;
+        target.cpu_base = slot * max(cpu_budget / slots, 1);
+        if (job.cancel) {
+            target.report.path = path;
+            target.report.status = "cancelled";
+            lock_guard<mutex> guard(batch_lock);
+            report_file(job, target.report);
+            return;
+        }
+        bool inspected = inspect_target(path, target, out);
+        if (!inspected) {
+            job.progress.setup_errors++;
+        }
+        bool ok = inspected && shred_target(target, options, schedule, job, out);
 
-                size_t written = fwrite(buffer, 1, bytes_to_write, file);
-                
-                if (written != static_cast<size_t>(bytes_to_write)) {
-                    delete[] buffer;
-                    break;
-                }
+        lock_guard<mutex> guard(batch_lock);
+        cout << buffered.str() << flush;
+        report_file(job, target.report);
+        if (!ok) {
+            return;
+        }
+        file_ok[i] = 1;
+        shredded++;
 
-                current_offset += bytes_to_write;
-                bytes_remaining -= bytes_to_write;
-                
-                // Update progress
-                #pragma omp atomic
-                total_bytes_processed += bytes_to_write;
-            }
+        if (delete_files) {
+            deleter.submit(batch[i], target.file_size, target.use_trim);
+            submitted.push_back(batch[i]);
+        }
+    });
 
-            fflush(file);
-            delete[] buffer;
+    // Every file shares the job key, so it goes once the last pass is done
+    if (schedule.crypto_erase) {
+        cout << "\n";
+        discard_job_key(cout);
+    }
+
+    vector<string> failed;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (!file_ok[i]) {
+            failed.push_back(batch[i]);
         }
-        
-        // Show completion for this pass
-        cout << "  Pass " << pass << "/" << passes << " (" << pattern_name << ") ";
-        display_progress_bar(100, pass, passes);
-        cout << " done\n";
     }
 
-    auto end_time = chrono::high_resolution_clock::now();
+    vector<string> undeleted = deleter.finish();
+    job.progress.delete_errors += undeleted.size();
+    report_deletes(job, deleter, submitted);
+
     auto duration = chrono::duration_cast<chrono::milliseconds>(
-        end_time - start_time
+        chrono::high_resolution_clock::now() - start_time
     );
 
-    fflush(file);
-    fclose(file);
-
-    cout << "\nCompleted in " << duration.count() << " ms";
-    cout << " (" << fixed << setprecision(2)
-              << (file_size * passes / (duration.count() / 1000.0) / (1024 * 1024))
-              << " MB/s)\n";
-
-    cout << "\nDelete file? (y/n): ";
-    
-    if (!get_deletion_confirmation()) {
-        cout << "\nFile kept (overwritten data remains on disk)\n\n";
-        return 0;
+    cout << "\nBatch completed in " << duration.count() << " ms\n";
+    cout << "  + Shredded: " << shredded << "/" << batch.size() << "\n";
+    if (delete_files) {
+        cout << "  + Deleted: " << deleter.deleted_count() << "/" << shredded << "\n";
     }
-    
-    // Perform secure deletion and space freeing
-    cout << "\nDeleting...\n";
-    
-    bool deletion_success = secure_delete_file(file_path, is_ssd_device, file_size);
-    
-    if (deletion_success) {
-        cout << "  + File deleted successfully\n";
-        if (is_ssd_device) {
-            cout << "  + TRIM issued (SSD will free blocks)\n";
-        }
-    } else {
-        cout << "  ! Deletion failed (manual removal may be needed)\n";
+    for (const string& path : failed) {
+        cout << "  ! Not shredded: " << path << "\n";
+    }
+    for (const string& path : undeleted) {
+        cout << "  ! Not deleted: " << path << "\n";
     }
-    
     cout << "\n";
 
-    return 0;
+    return (failed.empty() && undeleted.empty()) ? 0 : 1;
 }
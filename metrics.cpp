@@ -0,0 +1,159 @@
+// Parallel Digital Shredder - Metrics Export
+// Snapshot-only: the exporter never blocks the engine, it just reads the
+// progress atomics and merges the latency histograms
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include "histogram.h"
+#include "metrics.h"
+
+using namespace std;
+
+// Histogram bucket bounds exported per stage, in seconds
+static const double LATENCY_BOUNDS[] = {
+    0.00001, 0.0001, 0.001, 0.01, 0.1, 1.0, 10.0
+};
+
+static double unix_time() {
+    return chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void metric_header(ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+MetricsExporter::MetricsExporter(const string& path, double interval_sec,
+                                 const JobProgress& progress, const JobStats* stats)
+    : path(path),
+      interval(interval_sec),
+      progress(progress),
+      stats(stats),
+      start_time(unix_time()) {
+    last_time = start_time;
+    last_progress_time = start_time;
+    write_file(true);
+    worker = thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    write_file(false);
+}
+
+void MetricsExporter::run() {
+    auto period = chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(interval));
+
+    unique_lock<mutex> guard(lock);
+    while (!wake.wait_for(guard, period, [this] { return stopping; })) {
+        write_file(true);
+    }
+}
+
+void MetricsExporter::write_file(bool running) {
+    double now = unix_time();
+    long bytes = progress.bytes_written.load();
+    if (bytes != last_bytes) {
+        last_progress_time = now;
+    }
+    if (now > last_time) {
+        throughput = (bytes - last_bytes) / (now - last_time);
+    }
+    last_bytes = bytes;
+    last_time = now;
+
+    long file_size = progress.file_size.load();
+    double pass_ratio = 0.0;
+    if (file_size > 0 && progress.pass.load() > 0) {
+        pass_ratio = static_cast<double>(bytes - progress.pass_start_bytes.load()) / file_size;
+        pass_ratio = (pass_ratio > 1.0) ? 1.0 : pass_ratio;
+    }
+
+    ostringstream out;
+    out.precision(10);
+
+    metric_header(out, "shredder_job_running", "gauge", "1 while the job runs, 0 once it has ended.");
+    out << "shredder_job_running " << (running ? 1 : 0) << "\n";
+    metric_header(out, "shredder_start_timestamp_seconds", "gauge", "Unix time the job started.");
+    out << "shredder_start_timestamp_seconds " << start_time << "\n";
+    metric_header(out, "shredder_last_progress_timestamp_seconds", "gauge",
+                  "Unix time bytes_written last increased; alert when it stops moving.");
+    out << "shredder_last_progress_timestamp_seconds " << last_progress_time << "\n";
+
+    metric_header(out, "shredder_bytes_written_total", "counter", "Bytes written by overwrite passes.");
+    out << "shredder_bytes_written_total " << bytes << "\n";
+    metric_header(out, "shredder_write_throughput_bytes_per_second", "gauge",
+                  "Write rate since the previous snapshot.");
+    out << "shredder_write_throughput_bytes_per_second " << throughput << "\n";
+
+    metric_header(out, "shredder_files", "gauge", "Files in the job.");
+    out << "shredder_files " << progress.files_total.load() << "\n";
+    metric_header(out, "shredder_files_completed_total", "counter", "Files fully overwritten.");
+    out << "shredder_files_completed_total " << progress.files_done.load() << "\n";
+    metric_header(out, "shredder_file_size_bytes", "gauge", "Size of the file being shredded.");
+    out << "shredder_file_size_bytes " << file_size << "\n";
+    metric_header(out, "shredder_pass", "gauge", "Current pass of the file being shredded, 0 between files.");
+    out << "shredder_pass " << progress.pass.load() << "\n";
+    metric_header(out, "shredder_passes", "gauge", "Passes scheduled for the file being shredded.");
+    out << "shredder_passes " << progress.passes.load() << "\n";
+    metric_header(out, "shredder_pass_progress_ratio", "gauge", "Fraction of the current pass written.");
+    out << "shredder_pass_progress_ratio " << pass_ratio << "\n";
+
+    metric_header(out, "shredder_errors_total", "counter", "Failures by stage.");
+    out << "shredder_errors_total{stage=\"setup\"} " << progress.setup_errors.load() << "\n";
+    out << "shredder_errors_total{stage=\"write\"} " << progress.write_errors.load() << "\n";
+    out << "shredder_errors_total{stage=\"delete\"} " << progress.delete_errors.load() << "\n";
+    out << "shredder_errors_total{stage=\"verify\"} " << progress.verify_errors.load() << "\n";
+    metric_header(out, "shredder_write_retries_total", "counter",
+                  "Short writes and transient write errors that were retried.");
+    out << "shredder_write_retries_total " << progress.write_retries.load() << "\n";
+
+    if (stats) {
+        StageHistograms merged;
+        stats->snapshot(merged);
+
+        metric_header(out, "shredder_stage_latency_seconds", "histogram",
+                      "Latency of fill, wait, write, flush, trim and verify operations.");
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const LatencyHistogram& histogram = merged.stages[stage];
+            const char* name = stage_name(static_cast<Stage>(stage));
+            for (double bound : LATENCY_BOUNDS) {
+                out << "shredder_stage_latency_seconds_bucket{stage=\"" << name << "\",le=\""
+                    << bound << "\"} "
+                    << histogram.count_at_most(static_cast<uint64_t>(bound * 1e9)) << "\n";
+            }
+            uint64_t count = histogram.count_at_most(UINT64_MAX);
+            out << "shredder_stage_latency_seconds_bucket{stage=\"" << name << "\",le=\"+Inf\"} "
+                << count << "\n";
+            out << "shredder_stage_latency_seconds_sum{stage=\"" << name << "\"} "
+                << histogram.total() / 1e9 << "\n";
+            out << "shredder_stage_latency_seconds_count{stage=\"" << name << "\"} "
+                << count << "\n";
+        }
+    }
+
+    string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "w");
+    bool ok = file != NULL;
+    if (file) {
+        string text = out.str();
+        ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+        ok = (fclose(file) == 0) && ok;
+    }
+    if (ok && rename(temp_path.c_str(), path.c_str()) != 0) {
+        ok = false;
+    }
+
+    if (!ok && !warned) {
+        cerr << "Warning: Cannot write metrics file " << path << "\n";
+        warned = true;
+    }
+}
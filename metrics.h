@@ -0,0 +1,62 @@
+// Parallel Digital Shredder - Metrics Export
+// Job progress counters and a Prometheus textfile writer for them
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class JobStats;
+
+// Written by the engine and main thread, read by the exporter at any time
+struct JobProgress {
+    std::atomic<long> bytes_written{0};     // all files, all passes
+    std::atomic<long> pass_start_bytes{0};  // bytes_written when the pass began
+    std::atomic<long> file_size{0};         // file being shredded
+    std::atomic<int> pass{0};               // 1-based, 0 = between files
+    std::atomic<int> passes{0};
+    std::atomic<int> files_total{0};
+    std::atomic<int> files_done{0};
+    std::atomic<long> setup_errors{0};      // validation, open, space checks
+    std::atomic<long> write_errors{0};
+    std::atomic<long> write_retries{0};     // recovered short writes, EINTR, EAGAIN
+    std::atomic<long> delete_errors{0};
+    std::atomic<long> verify_errors{0};     // files whose readback did not match
+};
+
+// Rewrites `path` every `interval_sec` in the Prometheus text format, via a
+// temporary file and rename() so collectors never read a partial file
+// (node_exporter textfile collector: give it a .prom name). The destructor
+// writes a final snapshot with shredder_job_running 0.
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& path, double interval_sec,
+                    const JobProgress& progress, const JobStats* stats);
+    ~MetricsExporter();
+
+private:
+    std::string path;
+    double interval;
+    const JobProgress& progress;
+    const JobStats* stats;
+    double start_time;
+    long last_bytes = 0;
+    double last_time;
+    double last_progress_time;
+    double throughput = 0.0;
+    bool warned = false;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    void run();
+    void write_file(bool running);
+};
+
+#endif // METRICS_H
@@ -0,0 +1,289 @@
+// Parallel Digital Shredder - NUMA Topology
+// Reads node layout from sysfs, no libnuma dependency
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include "numa.h"
+#include "topology.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+int numa_node_count() {
+    return 1;
+}
+
+int storage_numa_node(const char*) {
+    return -1;
+}
+
+vector<int> plan_worker_cpus(int num_threads, int, int first) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cpus = info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+
+    vector<int> plan;
+    for (int i = 0; i < num_threads; i++) {
+        plan.push_back((first + i) % cpus);
+    }
+    return plan;
+}
+
+bool pin_current_thread(int cpu, ThreadAffinity* saved) {
+    if (cpu < 0 || cpu >= 64) {
+        return false;
+    }
+    DWORD_PTR previous = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+    if (saved) {
+        *saved = previous;
+    }
+    return previous != 0;
+}
+
+void restore_thread_affinity(const ThreadAffinity& saved) {
+    SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(saved));
+}
+
+static unsigned char* map_buffer(size_t size) {
+    unsigned char* buffer = static_cast<unsigned char*>(
+        VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (buffer) {
+        memset(buffer, 0, size);
+    }
+    return buffer;
+}
+
+static void unmap_buffer(unsigned char* buffer, size_t) {
+    VirtualFree(buffer, 0, MEM_RELEASE);
+}
+#else
+// Parse a sysfs list such as "0-3,8-11"
+static vector<int> parse_cpu_list(const char* text) {
+    vector<int> cpus;
+    const char* p = text;
+
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*p == ',') {
+            p++;
+        } else {
+            break;
+        }
+    }
+
+    return cpus;
+}
+
+// CPUs this process may run on, taken once at startup: sched_getaffinity
+// only reports the calling thread, which may be a worker pinned by an
+// earlier job
+struct ProcessCpus {
+    cpu_set_t allowed;
+    bool have_mask;
+
+    ProcessCpus() {
+        CPU_ZERO(&allowed);
+        have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    }
+};
+
+static const ProcessCpus process_cpus;
+
+// CPUs of each node, restricted to the ones this process may run on
+static vector<vector<int>> read_node_cpus() {
+    const cpu_set_t& allowed = process_cpus.allowed;
+    bool have_mask = process_cpus.have_mask;
+
+    vector<int> online;
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f) {
+        char line[256] = "";
+        if (fgets(line, sizeof(line), f)) {
+            online = parse_cpu_list(line);
+        }
+        fclose(f);
+    }
+
+    vector<vector<int>> nodes;
+    for (int node : online) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+
+        char line[4096] = "";
+        if (!fgets(line, sizeof(line), f)) {
+            line[0] = '\0';
+        }
+        fclose(f);
+
+        if (nodes.size() <= static_cast<size_t>(node)) {
+            nodes.resize(node + 1);
+        }
+        for (int cpu : parse_cpu_list(line)) {
+            if (!have_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                nodes[node].push_back(cpu);
+            }
+        }
+    }
+
+    // Non-NUMA kernel: treat every allowed CPU as node 0
+    size_t total = 0;
+    for (const auto& cpus : nodes) {
+        total += cpus.size();
+    }
+    if (total == 0) {
+        nodes.assign(1, vector<int>());
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < (cpu_count > 0 ? cpu_count : 1) && cpu < CPU_SETSIZE; cpu++) {
+            if (!have_mask || CPU_ISSET(cpu, &allowed)) {
+                nodes[0].push_back(cpu);
+            }
+        }
+    }
+
+    return nodes;
+}
+
+int numa_node_count() {
+    int count = 0;
+    for (const auto& cpus : read_node_cpus()) {
+        if (!cpus.empty()) {
+            count++;
+        }
+    }
+    return count > 0 ? count : 1;
+}
+
+int storage_numa_node(const char* path) {
+    return storage_info(path).numa_node;
+}
+
+vector<int> plan_worker_cpus(int num_threads, int preferred_node, int first) {
+    vector<vector<int>> nodes = read_node_cpus();
+
+    // Storage-local node first so the lowest thread ids submit I/O from it
+    vector<int> order;
+    if (preferred_node >= 0 && static_cast<size_t>(preferred_node) < nodes.size()) {
+        order = nodes[preferred_node];
+    }
+    for (size_t node = 0; node < nodes.size(); node++) {
+        if (static_cast<int>(node) != preferred_node) {
+            order.insert(order.end(), nodes[node].begin(), nodes[node].end());
+        }
+    }
+    if (order.empty()) {
+        order.push_back(0);
+    }
+
+    vector<int> plan;
+    for (int i = 0; i < num_threads; i++) {
+        plan.push_back(order[(first + i) % order.size()]);
+    }
+    return plan;
+}
+
+bool pin_current_thread(int cpu, ThreadAffinity* saved) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    if (saved && sched_getaffinity(0, sizeof(*saved), saved) != 0) {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 0 applies to the calling thread only
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+void restore_thread_affinity(const ThreadAffinity& saved) {
+    sched_setaffinity(0, sizeof(saved), &saved);
+}
+
+static unsigned char* map_buffer(size_t size) {
+    void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        return NULL;
+    }
+
+    // First touch from this thread places the pages on its node
+    memset(buffer, 0, size);
+    return static_cast<unsigned char*>(buffer);
+}
+
+static void unmap_buffer(unsigned char* buffer, size_t size) {
+    munmap(buffer, size);
+}
+#endif
+
+// Buffers parked per thread while the arena is on; a pinned worker gets
+// its own node-local pages back on the next pass or job
+static const size_t ARENA_BUFFERS_PER_THREAD = 8;
+
+struct BufferArena {
+    vector<pair<unsigned char*, size_t>> parked;
+
+    ~BufferArena() {
+        for (auto& buffer : parked) {
+            unmap_buffer(buffer.first, buffer.second);
+        }
+    }
+};
+
+static atomic<bool> arena_enabled(false);
+static thread_local BufferArena arena;
+
+void keep_local_buffers(bool keep) {
+    arena_enabled = keep;
+}
+
+unsigned char* alloc_local_buffer(size_t size) {
+    for (size_t i = 0; i < arena.parked.size(); i++) {
+        if (arena.parked[i].second == size) {
+            unsigned char* buffer = arena.parked[i].first;
+            arena.parked.erase(arena.parked.begin() + i);
+            return buffer;
+        }
+    }
+    return map_buffer(size);
+}
+
+void free_local_buffer(unsigned char* buffer, size_t size) {
+    if (!buffer) {
+        return;
+    }
+    if (arena_enabled && arena.parked.size() < ARENA_BUFFERS_PER_THREAD) {
+        arena.parked.push_back(make_pair(buffer, size));
+        return;
+    }
+    unmap_buffer(buffer, size);
+}
@@ -0,0 +1,45 @@
+// Parallel Digital Shredder - NUMA Topology
+// CPU-to-node mapping, worker pinning and node-local buffer allocation
+
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+#ifdef _WIN32
+typedef unsigned long long ThreadAffinity;
+#else
+#include <sched.h>
+typedef cpu_set_t ThreadAffinity;
+#endif
+
+// Number of NUMA nodes with usable CPUs (1 on non-NUMA systems)
+int numa_node_count();
+
+// NUMA node of the controller backing `path`, or -1 if unknown
+int storage_numa_node(const char* path);
+
+// CPU for each of `num_threads` workers, filling `preferred_node` first.
+// `first` skips that many CPUs of the order, so teams running side by
+// side can take different CPUs.
+std::vector<int> plan_worker_cpus(int num_threads, int preferred_node, int first = 0);
+
+// Pin the calling thread to a single CPU. If `saved` is given, the
+// affinity the thread had before is stored there.
+bool pin_current_thread(int cpu, ThreadAffinity* saved = nullptr);
+
+// Put back an affinity saved by pin_current_thread
+void restore_thread_affinity(const ThreadAffinity& saved);
+
+// Page-aligned buffer, first-touched by the calling thread so the pages
+// land on that thread's node
+unsigned char* alloc_local_buffer(size_t size);
+void free_local_buffer(unsigned char* buffer, size_t size);
+
+// Keep freed buffers in a per-thread arena for reuse instead of unmapping
+// them. Reused buffers hold old pattern data, not zeros. For long-running
+// processes whose worker threads persist between jobs.
+void keep_local_buffers(bool keep);
+
+#endif // NUMA_H
@@ -0,0 +1,422 @@
+// Parallel Digital Shredder - Pattern Schedules
+// Profiles are constexpr tables; the engine only ever sees resolved kernels
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include "cpu.h"
+#include "keystream.h"
+#include "pattern.h"
+
+#ifdef HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#define CONST(b)        { FILL_CONSTANT, 1, { b }, 0 }
+#define TRIPLE(a, b, c) { FILL_PERIODIC, 3, { a, b, c }, 0 }
+#define RANDOM          { FILL_RANDOM,   1, { 0 }, 0 }
+
+// DoD 5220.22-M (E): zeros, ones, random
+static constexpr PassPattern DOD3_PASSES[] = {
+    CONST(0x00), CONST(0xFF), RANDOM
+};
+
+// DoD 5220.22-M (ECE): (E), one random pass (C), (E) again
+static constexpr PassPattern DOD7_PASSES[] = {
+    CONST(0x00), CONST(0xFF), RANDOM,
+    RANDOM,
+    CONST(0x00), CONST(0xFF), RANDOM
+};
+
+// Gutmann 1996: 4 random, 27 MFM/RLL patterns, 4 random
+static constexpr PassPattern GUTMANN_PASSES[] = {
+    RANDOM, RANDOM, RANDOM, RANDOM,
+    CONST(0x55), CONST(0xAA),
+    TRIPLE(0x92, 0x49, 0x24), TRIPLE(0x49, 0x24, 0x92), TRIPLE(0x24, 0x92, 0x49),
+    CONST(0x00), CONST(0x11), CONST(0x22), CONST(0x33),
+    CONST(0x44), CONST(0x55), CONST(0x66), CONST(0x77),
+    CONST(0x88), CONST(0x99), CONST(0xAA), CONST(0xBB),
+    CONST(0xCC), CONST(0xDD), CONST(0xEE), CONST(0xFF),
+    TRIPLE(0x92, 0x49, 0x24), TRIPLE(0x49, 0x24, 0x92), TRIPLE(0x24, 0x92, 0x49),
+    TRIPLE(0x6D, 0xB6, 0xDB), TRIPLE(0xB6, 0xDB, 0x6D), TRIPLE(0xDB, 0x6D, 0xB6),
+    RANDOM, RANDOM, RANDOM, RANDOM
+};
+
+// NIST SP 800-88 Clear: one pass of a fixed value
+static constexpr PassPattern NIST_CLEAR_PASSES[] = {
+    CONST(0x00)
+};
+
+static constexpr PassPattern RANDOM_PASSES[] = {
+    RANDOM
+};
+
+#undef CONST
+#undef TRIPLE
+#undef RANDOM
+
+struct Profile {
+    const char* name;
+    const char* description;
+    const PassPattern* passes;
+    int count;
+    bool crypto_erase;
+};
+
+#define PROFILE(name, description, table) \
+    { name, description, table, static_cast<int>(sizeof(table) / sizeof(table[0])), false }
+#define CRYPTO_PROFILE(name, description, table) \
+    { name, description, table, static_cast<int>(sizeof(table) / sizeof(table[0])), true }
+
+static constexpr Profile PROFILES[] = {
+    PROFILE("dod3",       "DoD 5220.22-M (E): 0x00, 0xFF, random",       DOD3_PASSES),
+    PROFILE("dod7",       "DoD 5220.22-M (ECE): 7 passes",               DOD7_PASSES),
+    PROFILE("gutmann",    "Gutmann: 35 passes incl. MFM/RLL patterns",   GUTMANN_PASSES),
+    PROFILE("nist-clear", "NIST SP 800-88 Clear: single 0x00 pass",      NIST_CLEAR_PASSES),
+    PROFILE("random",     "Single random pass",                          RANDOM_PASSES),
+    CRYPTO_PROFILE("crypto-erase", "One random pass, key discarded, then delete", RANDOM_PASSES)
+};
+
+#undef PROFILE
+#undef CRYPTO_PROFILE
+
+static void fill_constant(unsigned char* buffer, long length, long, const PassPattern& pattern) {
+    // The C library's memset is already dispatched on the CPU
+    memset(buffer, pattern.bytes[0], length);
+}
+
+// Seed one period at the right phase, then keep doubling the filled prefix;
+// every copy is a whole number of periods so the phase stays continuous
+static void fill_periodic(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    long seed = (length < pattern.period) ? length : pattern.period;
+    for (long i = 0; i < seed; i++) {
+        buffer[i] = pattern.bytes[(offset + i) % pattern.period];
+    }
+
+    long filled = seed;
+    while (filled < length) {
+        long copy = (filled < length - filled) ? filled : length - filled;
+        memcpy(buffer + filled, buffer, copy);
+        filled += copy;
+    }
+}
+
+// Random passes are the job keystream under a per-pass nonce
+static void fill_random_aes(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    aes_ctr_keystream(buffer, length, offset, pattern.nonce);
+}
+
+static void fill_random_chacha(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    chacha20_keystream(buffer, length, offset, pattern.nonce);
+}
+
+// Scalar bytes at the pattern phase of `offset`; head and tail of the
+// vector kernels
+static void fill_bytes(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    for (long i = 0; i < length; i++) {
+        buffer[i] = pattern.bytes[(offset + i) % pattern.period];
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// 48, 96 and 192 bytes are whole numbers of periods for every period up
+// to 4 and whole numbers of 16-, 32- and 64-byte vectors, so three
+// registers cycle forever at each width
+static_assert(MAX_PATTERN_BYTES <= 4, "vector blocks must stay a multiple of every period");
+
+__attribute__((target("sse2")))
+static void stream_repeat_sse2(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    // Scalar head up to the first 16-byte boundary
+    long head = min<long>((16 - (reinterpret_cast<uintptr_t>(buffer) & 15)) & 15, length);
+    fill_bytes(buffer, head, offset, pattern);
+    buffer += head;
+    offset += head;
+    length -= head;
+
+    alignas(16) unsigned char block[48];
+    fill_bytes(block, sizeof(block), offset, pattern);
+    const __m128i lane0 = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i lane1 = _mm_load_si128(reinterpret_cast<const __m128i*>(block + 16));
+    const __m128i lane2 = _mm_load_si128(reinterpret_cast<const __m128i*>(block + 32));
+
+    long i = 0;
+    for (; i + 48 <= length; i += 48) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(buffer + i), lane0);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(buffer + i + 16), lane1);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(buffer + i + 32), lane2);
+    }
+    if (i + 16 <= length) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(buffer + i), lane0);
+        i += 16;
+        if (i + 16 <= length) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(buffer + i), lane1);
+            i += 16;
+        }
+    }
+    // Order the streaming stores before anyone reads or syncs the pages
+    _mm_sfence();
+
+    fill_bytes(buffer + i, length - i, offset + i, pattern);
+}
+
+// Aligned store; `Stream` selects a non-temporal one for memory that is
+// written once and handed to the device
+template <bool Stream>
+__attribute__((target("avx2")))
+static inline void store_avx2(unsigned char* out, __m256i value) {
+    if (Stream) {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(out), value);
+    } else {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out), value);
+    }
+}
+
+template <bool Stream>
+__attribute__((target("avx512f")))
+static inline void store_avx512(unsigned char* out, __m512i value) {
+    if (Stream) {
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(out), value);
+    } else {
+        _mm512_store_si512(out, value);
+    }
+}
+
+// Constant and multi-byte patterns alike
+template <bool Stream>
+__attribute__((target("avx2")))
+static void repeat_avx2(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    long head = min<long>((32 - (reinterpret_cast<uintptr_t>(buffer) & 31)) & 31, length);
+    fill_bytes(buffer, head, offset, pattern);
+    buffer += head;
+    offset += head;
+    length -= head;
+
+    alignas(32) unsigned char block[96];
+    fill_bytes(block, sizeof(block), offset, pattern);
+    const __m256i lanes[3] = {
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(block)),
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(block + 32)),
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(block + 64))
+    };
+
+    long i = 0;
+    for (; i + 96 <= length; i += 96) {
+        store_avx2<Stream>(buffer + i, lanes[0]);
+        store_avx2<Stream>(buffer + i + 32, lanes[1]);
+        store_avx2<Stream>(buffer + i + 64, lanes[2]);
+    }
+    for (int lane = 0; i + 32 <= length; i += 32) {
+        store_avx2<Stream>(buffer + i, lanes[lane++]);
+    }
+    if (Stream) {
+        _mm_sfence();
+    }
+
+    fill_bytes(buffer + i, length - i, offset + i, pattern);
+}
+
+template <bool Stream>
+__attribute__((target("avx512f,avx512bw,avx512dq")))
+static void repeat_avx512(unsigned char* buffer, long length, long offset, const PassPattern& pattern) {
+    long head = min<long>((64 - (reinterpret_cast<uintptr_t>(buffer) & 63)) & 63, length);
+    fill_bytes(buffer, head, offset, pattern);
+    buffer += head;
+    offset += head;
+    length -= head;
+
+    alignas(64) unsigned char block[192];
+    fill_bytes(block, sizeof(block), offset, pattern);
+    const __m512i lanes[3] = {
+        _mm512_load_si512(block),
+        _mm512_load_si512(block + 64),
+        _mm512_load_si512(block + 128)
+    };
+
+    long i = 0;
+    for (; i + 192 <= length; i += 192) {
+        store_avx512<Stream>(buffer + i, lanes[0]);
+        store_avx512<Stream>(buffer + i + 64, lanes[1]);
+        store_avx512<Stream>(buffer + i + 128, lanes[2]);
+    }
+    for (int lane = 0; i + 64 <= length; i += 64) {
+        store_avx512<Stream>(buffer + i, lanes[lane++]);
+    }
+    if (Stream) {
+        _mm_sfence();
+    }
+
+    fill_bytes(buffer + i, length - i, offset + i, pattern);
+}
+#endif
+
+// Per instruction-set level: plain kernels, then non-temporal ones for
+// memory that is written once and then handed to the device. Indexed by
+// FillKind; random passes come from the keystream instead.
+struct FillKernels {
+    FillKernel fill[FILL_RANDOM];
+    FillKernel stream[FILL_RANDOM];
+};
+
+#define SCALAR_KERNELS { \
+    { fill_constant, fill_periodic }, \
+    { fill_constant, fill_periodic } }
+
+static const FillKernels KERNELS[ISA_COUNT] = {
+    SCALAR_KERNELS,
+#ifdef HAVE_X86_KERNELS
+    {
+        { fill_constant, fill_periodic },
+        { stream_repeat_sse2, stream_repeat_sse2 }
+    },
+    {
+        { fill_constant, repeat_avx2<false> },
+        { repeat_avx2<true>, repeat_avx2<true> }
+    },
+    {
+        { fill_constant, repeat_avx512<false> },
+        { repeat_avx512<true>, repeat_avx512<true> }
+    }
+#else
+    SCALAR_KERNELS, SCALAR_KERNELS, SCALAR_KERNELS
+#endif
+};
+
+#undef SCALAR_KERNELS
+
+static FillKernel random_kernel() {
+    return (keystream_kernel() == aes_ctr_keystream) ? fill_random_aes : fill_random_chacha;
+}
+
+FillKernel fill_kernel_for(FillKind kind) {
+    return (kind == FILL_RANDOM) ? random_kernel() : KERNELS[active_isa()].fill[kind];
+}
+
+FillKernel stream_kernel_for(FillKind kind) {
+    return (kind == FILL_RANDOM) ? random_kernel() : KERNELS[active_isa()].stream[kind];
+}
+
+void seed_pass(PassPattern& pattern) {
+    if (pattern.kind == FILL_RANDOM) {
+        system_random(&pattern.nonce, sizeof(pattern.nonce));
+    }
+}
+
+bool find_profile(const char* name, PassSchedule& schedule) {
+    for (const Profile& profile : PROFILES) {
+        if (strcmp(profile.name, name) == 0) {
+            schedule.name = profile.name;
+            schedule.passes.assign(profile.passes, profile.passes + profile.count);
+            schedule.crypto_erase = profile.crypto_erase;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_pass(const char* token, PassPattern& pattern) {
+    if (strcmp(token, "rand") == 0 || strcmp(token, "random") == 0) {
+        pattern = PassPattern{ FILL_RANDOM, 1, { 0 }, 0 };
+        return true;
+    }
+
+    // Hex bytes separated by ':' ("ff", "92:49:24"); optional 0x prefix
+    pattern = PassPattern{ FILL_CONSTANT, 0, { 0 }, 0 };
+    const char* p = token;
+    while (*p) {
+        if (pattern.period == MAX_PATTERN_BYTES) {
+            return false;
+        }
+        if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            p += 2;
+        }
+        char* end;
+        unsigned long value = strtoul(p, &end, 16);
+        if (end == p || end - p > 2 || value > 0xFF) {
+            return false;
+        }
+        pattern.bytes[pattern.period++] = static_cast<unsigned char>(value);
+        p = end;
+        if (*p == ':') {
+            p++;
+        } else if (*p) {
+            return false;
+        }
+    }
+
+    if (pattern.period == 0) {
+        return false;
+    }
+    if (pattern.period > 1) {
+        pattern.kind = FILL_PERIODIC;
+    }
+    return true;
+}
+
+bool parse_schedule(const char* spec, PassSchedule& schedule) {
+    schedule.name = "custom";
+    schedule.passes.clear();
+
+    string text = spec;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == string::npos) {
+            comma = text.size();
+        }
+
+        PassPattern pattern;
+        if (!parse_pass(text.substr(start, comma - start).c_str(), pattern)) {
+            return false;
+        }
+        schedule.passes.push_back(pattern);
+        start = comma + 1;
+    }
+
+    return !schedule.passes.empty();
+}
+
+PassSchedule default_schedule(int passes) {
+    PassSchedule schedule;
+    find_profile("dod3", schedule);
+    schedule.name = "default";
+    fit_schedule(schedule, passes);
+    return schedule;
+}
+
+void fit_schedule(PassSchedule& schedule, int passes) {
+    if (schedule.passes.empty() || passes < 1) {
+        return;
+    }
+
+    vector<PassPattern> fitted;
+    for (int i = 0; i < passes; i++) {
+        fitted.push_back(schedule.passes[i % schedule.passes.size()]);
+    }
+    schedule.passes.swap(fitted);
+}
+
+string pattern_name(const PassPattern& pattern) {
+    if (pattern.kind == FILL_RANDOM) {
+        return "rand";
+    }
+
+    string name = "0x";
+    for (int i = 0; i < pattern.period; i++) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02X", pattern.bytes[i]);
+        name += hex;
+    }
+    return name;
+}
+
+void list_profiles(vector<string>& lines) {
+    for (const Profile& profile : PROFILES) {
+        char line[128];
+        snprintf(line, sizeof(line), "%-12s %s", profile.name, profile.description);
+        lines.push_back(line);
+    }
+}
@@ -0,0 +1,71 @@
+// Parallel Digital Shredder - Pattern Schedules
+// Built-in sanitization profiles, user schedules and per-kind fill kernels
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Longest repeating multi-byte pattern (Gutmann needs 3)
+#define MAX_PATTERN_BYTES 4
+
+enum FillKind {
+    FILL_CONSTANT,      // one byte repeated
+    FILL_PERIODIC,      // `period` bytes repeated, phase follows the file offset
+    FILL_RANDOM         // job keystream under a per-pass nonce, seekable by offset
+};
+
+struct PassPattern {
+    FillKind kind;
+    int period;
+    unsigned char bytes[MAX_PATTERN_BYTES];
+    uint64_t nonce;     // random passes only; set per pass by seed_pass()
+};
+
+// Give a random pass a fresh nonce. The bytes at any offset depend only on
+// the job key, the nonce and the offset, so the same pattern regenerates
+// them for verification; other kinds are left as they are.
+void seed_pass(PassPattern& pattern);
+
+// Fill `length` bytes as they appear at file offset `offset`. Resolved once
+// per pass, for the active instruction-set level (see cpu.h), so the
+// write loop never branches on the pattern kind or the CPU.
+typedef void (*FillKernel)(unsigned char* buffer, long length, long offset,
+                           const PassPattern& pattern);
+FillKernel fill_kernel_for(FillKind kind);
+
+// Same output, written with non-temporal stores where the CPU has them;
+// for memory that is written once and then handed to the device
+FillKernel stream_kernel_for(FillKind kind);
+
+struct PassSchedule {
+    std::string name;
+    std::vector<PassPattern> passes;
+    // One random pass under a job key that is discarded once the pass is
+    // written (and verified); the file is then deleted and its blocks
+    // discarded without asking
+    bool crypto_erase = false;
+};
+
+// Built-in profile by name (dod3, dod7, gutmann, nist-clear, random,
+// crypto-erase)
+bool find_profile(const char* name, PassSchedule& schedule);
+
+// Comma-separated passes: "00", "ff", "rand", or multi-byte "92:49:24"
+bool parse_schedule(const char* spec, PassSchedule& schedule);
+
+// The original 0x00 / 0xFF / random cycle, `passes` long
+PassSchedule default_schedule(int passes);
+
+// Repeat or truncate `schedule` to exactly `passes` entries
+void fit_schedule(PassSchedule& schedule, int passes);
+
+// Short label such as "0x00", "0x924924" or "rand"
+std::string pattern_name(const PassPattern& pattern);
+
+// Profile names and descriptions for the usage text
+void list_profiles(std::vector<std::string>& lines);
+
+#endif // PATTERN_H
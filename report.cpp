@@ -0,0 +1,237 @@
+// Parallel Digital Shredder - Job Report
+// Times are steady_clock seconds, so fast files report real fractions of a
+// millisecond instead of rounding down to zero
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "report.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static double unix_time() {
+    return chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static double mb_per_second(double bytes, double seconds) {
+    return (seconds > 0) ? bytes / seconds / (1024 * 1024) : 0.0;
+}
+
+static string host_name() {
+#ifndef _WIN32
+    char name[256];
+    if (gethostname(name, sizeof(name)) == 0) {
+        name[sizeof(name) - 1] = '\0';
+        return name;
+    }
+#endif
+    return "";
+}
+
+static string json_string(const string& text) {
+    string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+static string csv_field(const string& text) {
+    if (text.find_first_of(",\"\r\n") == string::npos) {
+        return text;
+    }
+    string quoted = "\"";
+    for (char c : text) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+static double overwritten_bytes(const FileReport& file) {
+    return static_cast<double>(file.size) * file.passes.size();
+}
+
+JobReport::JobReport(const string& path)
+    : path(path),
+      host(host_name()),
+      start_time(unix_time()) {
+}
+
+void JobReport::add(const FileReport& file) {
+    files.push_back(file);
+}
+
+void JobReport::record_delete(const string& file_path, double seconds) {
+    for (auto file = files.rbegin(); file != files.rend(); ++file) {
+        if (file->path == file_path) {
+            file->delete_seconds = seconds;
+            if (seconds < 0 && file->status == "ok") {
+                file->status = "delete failed";
+            }
+            return;
+        }
+    }
+}
+
+string JobReport::json() const {
+    ostringstream out;
+    out.precision(6);
+    out << fixed;
+    write_json(out, unix_time() - start_time);
+    return out.str();
+}
+
+bool JobReport::write() const {
+    double wall_seconds = unix_time() - start_time;
+
+    ofstream out(path.c_str());
+    if (!out) {
+        cerr << "Warning: Cannot write report " << path << "\n";
+        return false;
+    }
+    out.precision(6);
+    out << fixed;
+
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        write_csv(out, wall_seconds);
+    } else {
+        write_json(out, wall_seconds);
+    }
+    out.close();
+    if (out.fail()) {
+        cerr << "Warning: Cannot write report " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void JobReport::write_json(ostream& out, double wall_seconds) const {
+    int succeeded = 0;
+    double bytes = 0, setup = 0, overwrite = 0, verification = 0, deletion = 0;
+    for (const FileReport& file : files) {
+        succeeded += (file.status == "ok") ? 1 : 0;
+        bytes += overwritten_bytes(file);
+        setup += file.setup_seconds;
+        overwrite += file.overwrite_seconds;
+        verification += (file.verify_seconds > 0) ? file.verify_seconds : 0;
+        deletion += (file.delete_seconds > 0) ? file.delete_seconds : 0;
+    }
+
+    out << "{\n";
+    out << "  \"host\": " << json_string(host) << ",\n";
+    out << "  \"start_time\": " << start_time << ",\n";
+    out << "  \"wall_seconds\": " << wall_seconds << ",\n";
+    out << "  \"summary\": {\n";
+    out << "    \"files\": " << files.size() << ",\n";
+    out << "    \"succeeded\": " << succeeded << ",\n";
+    out << "    \"bytes_written\": " << static_cast<long>(bytes) << ",\n";
+    out << "    \"setup_seconds\": " << setup << ",\n";
+    out << "    \"overwrite_seconds\": " << overwrite << ",\n";
+    out << "    \"verify_seconds\": " << verification << ",\n";
+    out << "    \"delete_seconds\": " << deletion << ",\n";
+    out << "    \"overwrite_mb_per_second\": " << mb_per_second(bytes, overwrite) << "\n";
+    out << "  },\n";
+    out << "  \"files\": [";
+
+    for (size_t i = 0; i < files.size(); i++) {
+        const FileReport& file = files[i];
+        out << (i > 0 ? "," : "") << "\n    {\n";
+        out << "      \"path\": " << json_string(file.path) << ",\n";
+        out << "      \"status\": " << json_string(file.status) << ",\n";
+        out << "      \"profile\": " << json_string(file.profile) << ",\n";
+        out << "      \"size\": " << file.size << ",\n";
+        out << "      \"device_class\": " << json_string(file.device_class) << ",\n";
+        out << "      \"backend\": " << json_string(file.backend) << ",\n";
+        out << "      \"pipeline\": " << json_string(file.pipeline) << ",\n";
+        out << "      \"direct_io\": " << (file.direct_io ? "true" : "false") << ",\n";
+        out << "      \"threads\": " << file.threads << ",\n";
+        out << "      \"setup_seconds\": " << file.setup_seconds << ",\n";
+        out << "      \"overwrite_seconds\": " << file.overwrite_seconds << ",\n";
+        out << "      \"verify_seconds\": ";
+        if (file.verify_seconds >= 0) {
+            out << file.verify_seconds;
+        } else {
+            out << "null";
+        }
+        out << ",\n";
+        out << "      \"delete_seconds\": ";
+        if (file.delete_seconds >= 0) {
+            out << file.delete_seconds;
+        } else {
+            out << "null";
+        }
+        out << ",\n";
+        out << "      \"overwrite_mb_per_second\": "
+            << mb_per_second(overwritten_bytes(file), file.overwrite_seconds) << ",\n";
+        out << "      \"passes\": [";
+        for (size_t pass = 0; pass < file.passes.size(); pass++) {
+            const PassReport& report = file.passes[pass];
+            out << (pass > 0 ? ", " : "") << "{\"pattern\": " << json_string(report.pattern)
+                << ", \"seconds\": " << report.seconds
+                << ", \"mb_per_second\": " << mb_per_second(file.size, report.seconds) << "}";
+        }
+        out << "]\n    }";
+    }
+
+    out << (files.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
+
+// One row per file, then a "total" row carrying the job's wall time;
+// pass_mb_s lists every pass, separated by ';'
+void JobReport::write_csv(ostream& out, double wall_seconds) const {
+    out << "host,path,status,profile,size_bytes,device_class,backend,pipeline,direct_io,threads,"
+           "passes,setup_s,overwrite_s,verify_s,delete_s,overwrite_mb_s,pass_mb_s,wall_s\n";
+
+    double bytes = 0, setup = 0, overwrite = 0, verification = 0, deletion = 0;
+    size_t passes = 0;
+    for (const FileReport& file : files) {
+        bytes += overwritten_bytes(file);
+        setup += file.setup_seconds;
+        overwrite += file.overwrite_seconds;
+        verification += (file.verify_seconds > 0) ? file.verify_seconds : 0;
+        deletion += (file.delete_seconds > 0) ? file.delete_seconds : 0;
+        passes += file.passes.size();
+
+        out << csv_field(host) << "," << csv_field(file.path) << "," << file.status << ","
+            << csv_field(file.profile) << ","
+            << file.size << "," << file.device_class << "," << file.backend << ","
+            << file.pipeline << "," << (file.direct_io ? 1 : 0) << "," << file.threads << ","
+            << file.passes.size() << "," << file.setup_seconds << "," << file.overwrite_seconds << ",";
+        if (file.verify_seconds >= 0) {
+            out << file.verify_seconds;
+        }
+        out << ",";
+        if (file.delete_seconds >= 0) {
+            out << file.delete_seconds;
+        }
+        out << "," << mb_per_second(overwritten_bytes(file), file.overwrite_seconds) << ",";
+        for (size_t pass = 0; pass < file.passes.size(); pass++) {
+            out << (pass > 0 ? ";" : "") << mb_per_second(file.size, file.passes[pass].seconds);
+        }
+        out << ",\n";
+    }
+
+    // The total row's size column holds every byte written, all passes
+    out << csv_field(host) << ",," << "total,," << static_cast<long>(bytes) << ",,,,,,"
+        << passes << "," << setup << "," << overwrite << "," << verification << "," << deletion << ","
+        << mb_per_second(bytes, overwrite) << ",," << wall_seconds << "\n";
+}
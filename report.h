@@ -0,0 +1,61 @@
+// Parallel Digital Shredder - Job Report
+// Per-file timings and chosen strategy, written as JSON or CSV at job end
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct PassReport {
+    std::string pattern;
+    double seconds = 0.0;           // run_pass including its flush
+};
+
+struct FileReport {
+    std::string path;
+    std::string status = "ok";      // ok, setup/write/verify/delete failed, cancelled
+    std::string profile;            // schedule name; "crypto-erase" for that mode
+    long size = 0;
+    std::string device_class;
+    std::string backend;
+    std::string pipeline;           // empty for mmap
+    bool direct_io = false;
+    int threads = 0;
+    std::vector<PassReport> passes;
+    double setup_seconds = 0.0;     // validation, detection, planning, open
+    double overwrite_seconds = 0.0;
+    double verify_seconds = -1.0;   // < 0 = not verified
+    double delete_seconds = -1.0;   // < 0 = not deleted
+};
+
+// Collects one FileReport per target and writes them with job totals.
+// The format follows the extension: .csv, otherwise JSON.
+class JobReport {
+public:
+    explicit JobReport(const std::string& path);
+
+    void add(const FileReport& file);
+
+    // Delete time of the last file added under `path`; < 0 marks the
+    // deletion as failed
+    void record_delete(const std::string& path, double seconds);
+
+    // Writes the report; wall time runs from construction to this call
+    bool write() const;
+
+    // The JSON form as a string, for callers that keep the report in memory
+    std::string json() const;
+
+private:
+    std::string path;
+    std::string host;
+    double start_time;
+    std::vector<FileReport> files;
+
+    void write_json(std::ostream& out, double wall_seconds) const;
+    void write_csv(std::ostream& out, double wall_seconds) const;
+};
+
+#endif // REPORT_H
@@ -0,0 +1,227 @@
+// Parallel Digital Shredder - I/O Strategy Selection
+// One row per device class; user overrides are applied by the caller
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <omp.h>
+#include "strategy.h"
+
+using namespace std;
+
+// Largest write size a device's optimal_io_size may push the unit to
+static const long MAX_UNIT_SIZE = 16L * 1024 * 1024;
+
+// Up to this size, mapping the file costs less than a buffer per thread
+// plus one write call per unit
+static const long MMAP_MAX_FILE_SIZE = 8L * 1024 * 1024;
+
+// Fewer units per worker than this and thread start-up costs more than the
+// parallel writes save
+static const long MIN_UNITS_PER_THREAD = 4;
+
+// Gain a doubled worker count must show to be kept
+static const double RAMP_GAIN = 0.10;
+
+struct ClassDefaults {
+    const char* name;
+    int max_threads;        // 0 = all cores
+    long unit_size;
+    bool direct_io;
+    bool use_trim;
+    PipelineKind pipeline;
+    int writers;            // pipelined only; the other threads generate
+    int ring_slots;         // pipelined only
+    int files_in_flight;    // files of a batch shredded at once on one device
+};
+
+static const ClassDefaults CLASS_DEFAULTS[] = {
+    // DEVICE_UNKNOWN: previous behaviour, every core with 1 MB writes
+    { "unknown",  0,  1024 * 1024,     false, false, PIPELINE_CHUNKED,    0, 0,  1 },
+    // DEVICE_HDD: one writer streams front to back, extra threads only
+    // generate data so the head never seeks between chunks
+    { "hdd",      4,  4 * 1024 * 1024, false, false, PIPELINE_SEQUENTIAL, 1, 8,  1 },
+    // DEVICE_SATA_SSD: two writers saturate the 6 Gb/s link when fed
+    { "sata-ssd", 8,  1024 * 1024,     true,  true,  PIPELINE_OVERLAPPED, 2, 16, 2 },
+    // DEVICE_NVME: needs many concurrent writes to fill its queues
+    { "nvme",     16, 1024 * 1024,     true,  true,  PIPELINE_OVERLAPPED, 4, 32, 4 },
+    // DEVICE_MEMORY: bound by memory bandwidth; discard frees the pages
+    { "memory",   4,  1024 * 1024,     false, true,  PIPELINE_CHUNKED,    0, 0,  2 },
+    // DEVICE_NETWORK: fewer, larger requests amortise round trips
+    { "network",  4,  4 * 1024 * 1024, false, false, PIPELINE_CHUNKED,    0, 0,  2 }
+};
+
+DeviceClass classify_device(const StorageInfo& info, bool ssd_hint) {
+    if (info.memory) {
+        return DEVICE_MEMORY;
+    }
+    if (info.network) {
+        return DEVICE_NETWORK;
+    }
+    if (!info.valid) {
+        return ssd_hint ? DEVICE_SATA_SSD : DEVICE_UNKNOWN;
+    }
+    if (info.rotational) {
+        return DEVICE_HDD;
+    }
+    for (const auto& disk : info.disks) {
+        if (disk.compare(0, 4, "nvme") != 0) {
+            return DEVICE_SATA_SSD;
+        }
+    }
+    return info.disks.empty() ? DEVICE_SATA_SSD : DEVICE_NVME;
+}
+
+const char* device_class_name(DeviceClass device_class) {
+    return CLASS_DEFAULTS[device_class].name;
+}
+
+int device_concurrency(DeviceClass device_class) {
+    return CLASS_DEFAULTS[device_class].files_in_flight;
+}
+
+bool parse_device_class(const char* name, DeviceClass& device_class) {
+    for (int i = 0; i < static_cast<int>(sizeof(CLASS_DEFAULTS) / sizeof(CLASS_DEFAULTS[0])); i++) {
+        if (strcmp(name, CLASS_DEFAULTS[i].name) == 0) {
+            device_class = static_cast<DeviceClass>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+IoPlan select_io_plan(DeviceClass device_class, const StorageInfo& info,
+                      long file_size, int max_threads) {
+    const ClassDefaults& defaults = CLASS_DEFAULTS[device_class];
+    IoPlan plan;
+
+    plan.device_class = device_class;
+    plan.direct_io = defaults.direct_io;
+    plan.use_trim = defaults.use_trim && (info.discard_granularity > 0 || !info.valid ||
+                                          device_class == DEVICE_MEMORY);
+
+    int cores = (max_threads > 0) ? max_threads : omp_get_max_threads();
+    plan.threads = (defaults.max_threads > 0 && defaults.max_threads < cores)
+                   ? defaults.max_threads : cores;
+
+    // RAID and some NVMe namespaces report a preferred request size
+    plan.unit_size = defaults.unit_size;
+    if (info.optimal_io_size > static_cast<unsigned long>(plan.unit_size)) {
+        long optimal = static_cast<long>(info.optimal_io_size);
+        plan.unit_size = (optimal > MAX_UNIT_SIZE) ? MAX_UNIT_SIZE : optimal;
+    }
+
+    long by_size = file_size / (plan.unit_size * MIN_UNITS_PER_THREAD);
+    if (by_size < plan.threads) {
+        plan.threads = (by_size > 1) ? static_cast<int>(by_size) : 1;
+    }
+
+    // Direct I/O gains nothing on files smaller than one write
+    if (file_size < plan.unit_size) {
+        plan.direct_io = false;
+    }
+
+    // Shared mappings of network files are only as coherent as the client
+    // cache; keep explicit writes there
+    if (file_size > 0 && file_size <= MMAP_MAX_FILE_SIZE && device_class != DEVICE_NETWORK) {
+        plan.backend = BACKEND_MMAP;
+        plan.direct_io = false;
+    }
+
+    plan.pipeline = defaults.pipeline;
+    if (plan.pipeline == PIPELINE_CHUNKED) {
+        plan.writers = plan.threads;
+        plan.queue_depth = plan.threads;
+    } else {
+        plan.writers = defaults.writers;
+        plan.queue_depth = defaults.ring_slots;
+    }
+    return plan;
+}
+
+// A pipelined plan needs a writer and a generator to overlap anything
+ThreadTuner::ThreadTuner(int ceiling, int remembered)
+    : ceiling(ceiling) {
+    if (remembered > 0) {
+        current = min(remembered, ceiling);
+        done = true;
+    } else {
+        current = max(min(ceiling, 2), ceiling / 2);
+        done = (current >= ceiling);
+    }
+    best = current;
+}
+
+void ThreadTuner::record(long bytes, double seconds) {
+    if (done || seconds <= 0) {
+        return;
+    }
+
+    double rate = bytes / seconds;
+    if (best_rate > 0 && rate < best_rate * (1.0 + RAMP_GAIN)) {
+        // The last step did not pay for its threads
+        current = best;
+        done = true;
+        return;
+    }
+
+    best_rate = rate;
+    best = current;
+    if (current >= ceiling) {
+        done = true;
+    } else {
+        current = min(current * 2, ceiling);
+    }
+}
+
+static mutex tuned_lock;
+static map<string, int> tuned_threads;
+
+int remembered_threads(const string& device) {
+    lock_guard<mutex> guard(tuned_lock);
+    auto it = tuned_threads.find(device);
+    return (it == tuned_threads.end()) ? 0 : it->second;
+}
+
+void remember_threads(const string& device, int threads) {
+    lock_guard<mutex> guard(tuned_lock);
+    tuned_threads[device] = threads;
+}
+
+const char* pipeline_name(PipelineKind pipeline) {
+    switch (pipeline) {
+        case PIPELINE_CHUNKED: return "chunked";
+        case PIPELINE_SEQUENTIAL: return "sequential";
+        case PIPELINE_OVERLAPPED: return "pipelined";
+    }
+    return "unknown";
+}
+
+const char* backend_name(IoBackend backend) {
+    return (backend == BACKEND_MMAP) ? "mmap" : "pwrite";
+}
+
+const char* redundant_pass_reason(DeviceClass device_class, const StorageInfo& info,
+                                  const CowInfo& cow) {
+    static const char* const LOG_FILESYSTEMS[] = { "f2fs", "nilfs2" };
+
+    if (cow.copy_on_write) {
+        return "copy-on-write filesystem writes every pass to new extents";
+    }
+    for (const char* fs : LOG_FILESYSTEMS) {
+        if (info.fs_type == fs) {
+            return "log-structured filesystem appends every pass";
+        }
+    }
+
+    switch (device_class) {
+        case DEVICE_MEMORY:
+            return "RAM-backed, no remanence between passes";
+        case DEVICE_SATA_SSD:
+        case DEVICE_NVME:
+            return "flash translation layer remaps every pass to fresh pages";
+        default:
+            return NULL;
+    }
+}
@@ -0,0 +1,95 @@
+// Parallel Digital Shredder - I/O Strategy Selection
+// Picks threads, write size and I/O mode per detected device class
+
+#ifndef STRATEGY_H
+#define STRATEGY_H
+
+#include <string>
+#include "cow.h"
+#include "topology.h"
+
+enum DeviceClass {
+    DEVICE_UNKNOWN,
+    DEVICE_HDD,
+    DEVICE_SATA_SSD,
+    DEVICE_NVME,
+    DEVICE_MEMORY,
+    DEVICE_NETWORK
+};
+
+enum PipelineKind {
+    PIPELINE_CHUNKED,     // file split into one contiguous chunk per thread
+    PIPELINE_SEQUENTIAL,  // one writer streams the file, others fill buffers
+    PIPELINE_OVERLAPPED   // generator threads feed several writer threads
+};
+
+enum IoBackend {
+    BACKEND_PWRITE,       // positional writes from per-thread buffers
+    BACKEND_MMAP          // kernels fill the mapped page cache directly
+};
+
+struct IoPlan {
+    DeviceClass device_class = DEVICE_UNKNOWN;
+    int threads = 1;
+    long unit_size = 1024 * 1024;   // bytes per write call
+    int queue_depth = 1;            // writes in flight; ring slots when pipelined
+    int writers = 1;                // threads submitting writes when pipelined
+    bool direct_io = false;         // O_DIRECT, bypassing the page cache
+    bool use_trim = false;          // discard freed blocks on deletion
+    PipelineKind pipeline = PIPELINE_CHUNKED;
+    IoBackend backend = BACKEND_PWRITE;
+};
+
+// `ssd_hint` covers platforms where only is_ssd() can see the device
+DeviceClass classify_device(const StorageInfo& info, bool ssd_hint);
+const char* device_class_name(DeviceClass device_class);
+
+// Files of one batch worth shredding at the same time on a device of this
+// class; 1 for disks where parallel streams only add seeks
+int device_concurrency(DeviceClass device_class);
+
+// Parse a --device-class value; returns false for unknown names
+bool parse_device_class(const char* name, DeviceClass& device_class);
+
+// `max_threads` caps the plan (0 = all cores); small files get fewer
+// threads so every worker has a few units to write
+IoPlan select_io_plan(DeviceClass device_class, const StorageInfo& info,
+                      long file_size, int max_threads);
+
+// Worker count of the measured (random) passes of an automatic plan.
+// Starts below `ceiling` and doubles after each measured pass while
+// throughput still improves, then keeps the best count. A count
+// remembered for the device skips the ramp.
+class ThreadTuner {
+public:
+    ThreadTuner(int ceiling, int remembered);
+
+    int threads() const { return current; }
+    bool settled() const { return done; }
+
+    // Throughput of one pass at threads(); moves to the next count
+    void record(long bytes, double seconds);
+
+private:
+    int current;
+    int ceiling;
+    int best;
+    double best_rate = 0.0;
+    bool done;
+};
+
+// Tuned worker counts per device name, kept for the process lifetime
+// (0 = nothing remembered yet)
+int remembered_threads(const std::string& device);
+void remember_threads(const std::string& device, int threads);
+
+const char* pipeline_name(PipelineKind pipeline);
+const char* backend_name(IoBackend backend);
+
+// Why repeated passes over the same logical range never reach the blocks
+// that held the old data on this target (copy-on-write, log-structured or
+// RAM-backed), or NULL when in-place overwrites are meaningful
+const char* redundant_pass_reason(DeviceClass device_class, const StorageInfo& info,
+                                  const CowInfo& cow);
+
+#endif // STRATEGY_H
@@ -0,0 +1,119 @@
+// Parallel Digital Shredder - I/O Throttling
+// Writers reserve tokens up front and sleep off any deficit outside the lock
+
+#include <algorithm>
+#include <thread>
+#include "throttle.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+// Unused budget kept for bursts, in seconds of the configured rate
+static const double BURST_SECONDS = 0.1;
+
+// Adaptive mode never throttles below this fraction of the cap
+static const double MIN_ADAPTIVE_FRACTION = 0.05;
+
+RateLimiter::RateLimiter(double bytes_per_sec, double ops_per_sec, double target_latency_sec)
+    : last_refill(chrono::steady_clock::now()),
+      max_byte_rate(bytes_per_sec),
+      byte_rate(bytes_per_sec),
+      op_rate(ops_per_sec),
+      byte_tokens(bytes_per_sec * BURST_SECONDS),
+      op_tokens(ops_per_sec * BURST_SECONDS),
+      target_latency(target_latency_sec),
+      latency_avg(0.0) {
+}
+
+void RateLimiter::refill(chrono::steady_clock::time_point now) {
+    double elapsed = chrono::duration<double>(now - last_refill).count();
+    last_refill = now;
+
+    if (byte_rate > 0) {
+        byte_tokens = min(byte_tokens + elapsed * byte_rate, byte_rate * BURST_SECONDS);
+    }
+    if (op_rate > 0) {
+        op_tokens = min(op_tokens + elapsed * op_rate, op_rate * BURST_SECONDS);
+    }
+}
+
+void RateLimiter::acquire(long bytes) {
+    double wait = 0.0;
+
+    {
+        lock_guard<mutex> guard(lock);
+        refill(chrono::steady_clock::now());
+
+        // Reserve now; a negative balance is the time this writer must wait
+        if (byte_rate > 0) {
+            byte_tokens -= bytes;
+            if (byte_tokens < 0) {
+                wait = max(wait, -byte_tokens / byte_rate);
+            }
+        }
+        if (op_rate > 0) {
+            op_tokens -= 1.0;
+            if (op_tokens < 0) {
+                wait = max(wait, -op_tokens / op_rate);
+            }
+        }
+    }
+
+    if (wait > 0) {
+        this_thread::sleep_for(chrono::duration<double>(wait));
+    }
+}
+
+void RateLimiter::record_latency(double seconds) {
+    if (target_latency <= 0 || max_byte_rate <= 0) {
+        return;
+    }
+
+    lock_guard<mutex> guard(lock);
+    latency_avg = (latency_avg == 0.0) ? seconds : latency_avg * 0.8 + seconds * 0.2;
+
+    // Multiplicative decrease when the device is slowing down, slow
+    // additive-style recovery once it has headroom again
+    if (latency_avg > target_latency) {
+        byte_rate = max(byte_rate * 0.9, max_byte_rate * MIN_ADAPTIVE_FRACTION);
+    } else if (latency_avg < target_latency * 0.5) {
+        byte_rate = min(byte_rate * 1.02, max_byte_rate);
+    }
+}
+
+double RateLimiter::current_byte_rate() {
+    lock_guard<mutex> guard(lock);
+    return byte_rate;
+}
+
+#ifdef _WIN32
+bool set_low_io_priority() {
+    // Background mode lowers CPU, I/O and memory priority together
+    return SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN) != 0;
+}
+#else
+// From linux/ioprio.h, which is not shipped by every libc
+#define SHREDDER_IOPRIO_CLASS_SHIFT 13
+#define SHREDDER_IOPRIO_CLASS_IDLE  3
+#define SHREDDER_IOPRIO_WHO_PROCESS 1
+
+bool set_low_io_priority() {
+    bool ok = setpriority(PRIO_PROCESS, 0, 19) == 0;
+
+    // Idle class: only served when no other process wants the disk. Honoured
+    // by BFQ; with other schedulers use a cgroup io.weight instead.
+    int ioprio = SHREDDER_IOPRIO_CLASS_IDLE << SHREDDER_IOPRIO_CLASS_SHIFT;
+    if (syscall(SYS_ioprio_set, SHREDDER_IOPRIO_WHO_PROCESS, 0, ioprio) != 0) {
+        ok = false;
+    }
+
+    return ok;
+}
+#endif
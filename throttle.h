@@ -0,0 +1,42 @@
+// Parallel Digital Shredder - I/O Throttling
+// Token-bucket rate limiter shared by all workers, plus low-priority mode
+
+#ifndef THROTTLE_H
+#define THROTTLE_H
+
+#include <chrono>
+#include <mutex>
+
+class RateLimiter {
+public:
+    // Zero disables the corresponding cap. A non-zero target latency makes
+    // the byte rate adapt to observed write latency, never exceeding the cap.
+    RateLimiter(double bytes_per_sec, double ops_per_sec, double target_latency_sec);
+
+    // Block until `bytes` (one write) fits in the budget
+    void acquire(long bytes);
+
+    // Feed back the duration of a completed write
+    void record_latency(double seconds);
+
+    double current_byte_rate();
+
+private:
+    std::mutex lock;
+    std::chrono::steady_clock::time_point last_refill;
+    double max_byte_rate;
+    double byte_rate;
+    double op_rate;
+    double byte_tokens;
+    double op_tokens;
+    double target_latency;
+    double latency_avg;
+
+    void refill(std::chrono::steady_clock::time_point now);
+};
+
+// Lowest CPU and I/O scheduling class for this process; call before the
+// worker threads are created so they inherit it
+bool set_low_io_priority();
+
+#endif // THROTTLE_H
@@ -0,0 +1,314 @@
+// Parallel Digital Shredder - Storage Topology
+// st_dev -> /sys/dev/block -> partition parent -> dm/md slaves or loop backing file
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include "topology.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/statfs.h>
+#include <sys/sysmacros.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+const StorageInfo& storage_info(const char*) {
+    // Windows callers query the volume directly (see is_ssd in utils.cpp)
+    static const StorageInfo unknown;
+    return unknown;
+}
+#else
+// Loop devices backed by files on loop devices, dm on md on dm, ...
+static const int MAX_STACK_DEPTH = 8;
+
+static mutex cache_lock;
+static map<dev_t, StorageInfo> cache;
+
+static string read_sysfs_string(const string& path) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        return "";
+    }
+
+    char line[4096] = "";
+    if (!fgets(line, sizeof(line), f)) {
+        line[0] = '\0';
+    }
+    fclose(f);
+
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == ' ')) {
+        line[--len] = '\0';
+    }
+    return line;
+}
+
+static unsigned long read_sysfs_ulong(const string& path, unsigned long fallback) {
+    string text = read_sysfs_string(path);
+    if (text.empty()) {
+        return fallback;
+    }
+    return strtoul(text.c_str(), NULL, 10);
+}
+
+static string base_name(const string& path) {
+    size_t slash = path.rfind('/');
+    return (slash == string::npos) ? path : path.substr(slash + 1);
+}
+
+static string resolve_path(const string& path) {
+    char* resolved = realpath(path.c_str(), NULL);
+    if (!resolved) {
+        return "";
+    }
+    string result = resolved;
+    free(resolved);
+    return result;
+}
+
+static bool starts_with(const string& text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static const char* fs_type_name(long magic, bool& memory, bool& network) {
+    switch (static_cast<unsigned long>(magic) & 0xFFFFFFFFUL) {
+        case 0xEF53:     return "ext4";
+        case 0x58465342: return "xfs";
+        case 0x9123683E: return "btrfs";
+        case 0x2FC12FC1: return "zfs";
+        case 0xCA451A4E: return "bcachefs";
+        case 0xF2F52010: return "f2fs";
+        case 0x3434:     return "nilfs2";
+        case 0x4D44:     return "vfat";
+        case 0x2011BAB0: return "exfat";
+        case 0x5346544E: return "ntfs";
+        case 0x794C7630: return "overlay";
+        case 0x65735546: return "fuse";
+        case 0x01021994: memory = true;  return "tmpfs";
+        case 0x858458F6: memory = true;  return "ramfs";
+        case 0x6969:     network = true; return "nfs";
+        case 0xFF534D42: network = true; return "cifs";
+        case 0xFE534D42: network = true; return "smb2";
+        case 0x00C36400: network = true; return "ceph";
+        default:         return "unknown";
+    }
+}
+
+// Filesystems without a real block device (btrfs, zfs) report an anonymous
+// st_dev; their mountinfo entry still names the source device
+static dev_t mount_source_device(dev_t dev) {
+    FILE* f = fopen("/proc/self/mountinfo", "r");
+    if (!f) {
+        return 0;
+    }
+
+    dev_t source_dev = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int maj, min;
+        if (sscanf(line, "%*d %*d %u:%u", &maj, &min) != 2 ||
+            makedev(maj, min) != dev) {
+            continue;
+        }
+
+        // Fields after " - " are: fstype source options
+        const char* sep = strstr(line, " - ");
+        char source[1024];
+        if (!sep || sscanf(sep + 3, "%*s %1023s", source) != 1) {
+            continue;
+        }
+
+        struct stat source_stat;
+        if (stat(source, &source_stat) == 0 && S_ISBLK(source_stat.st_mode)) {
+            source_dev = source_stat.st_rdev;
+            break;
+        }
+    }
+    fclose(f);
+
+    return source_dev;
+}
+
+// Whole-disk sysfs directory for a block device number
+static string block_dir_for(dev_t dev) {
+    char link[64];
+    snprintf(link, sizeof(link), "/sys/dev/block/%u:%u", major(dev), minor(dev));
+
+    string dir = resolve_path(link);
+    if (dir.empty()) {
+        return "";
+    }
+
+    // Partitions live inside their disk's directory
+    struct stat st;
+    if (stat((dir + "/partition").c_str(), &st) == 0) {
+        dir.erase(dir.rfind('/'));
+    }
+    return dir;
+}
+
+static int find_numa_node(string dir) {
+    // The first numa_node walking up towards the root is the closest bus device
+    while (dir.size() > strlen("/sys/devices")) {
+        string text = read_sysfs_string(dir + "/numa_node");
+        if (!text.empty() && atoi(text.c_str()) >= 0) {
+            return atoi(text.c_str());
+        }
+        dir.erase(dir.rfind('/'));
+    }
+    return -1;
+}
+
+static void resolve_leaves(const string& dir, StorageInfo& info, int depth);
+
+static void resolve_loop(const string& dir, StorageInfo& info, int depth) {
+    string backing = read_sysfs_string(dir + "/loop/backing_file");
+    struct stat backing_stat;
+    if (backing.empty() || stat(backing.c_str(), &backing_stat) != 0) {
+        return;
+    }
+
+    dev_t dev = backing_stat.st_dev;
+    string backing_dir = block_dir_for(dev);
+    if (backing_dir.empty()) {
+        backing_dir = block_dir_for(mount_source_device(dev));
+    }
+
+    if (backing_dir.empty()) {
+        // Image file on tmpfs or a network share
+        bool memory = false, network = false;
+        struct statfs fs;
+        if (statfs(backing.c_str(), &fs) == 0) {
+            fs_type_name(fs.f_type, memory, network);
+        }
+        info.memory = info.memory || memory;
+        info.network = info.network || network;
+        return;
+    }
+
+    resolve_leaves(backing_dir, info, depth + 1);
+}
+
+static void resolve_leaves(const string& dir, StorageInfo& info, int depth) {
+    if (depth > MAX_STACK_DEPTH) {
+        return;
+    }
+
+    string name = base_name(dir);
+
+    // dm and md devices list their components under slaves/
+    bool stacked = false;
+    DIR* slaves = opendir((dir + "/slaves").c_str());
+    if (slaves) {
+        struct dirent* entry;
+        while ((entry = readdir(slaves)) != NULL) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            string slave = resolve_path(dir + "/slaves/" + entry->d_name);
+            if (slave.empty()) {
+                continue;
+            }
+            struct stat st;
+            if (stat((slave + "/partition").c_str(), &st) == 0) {
+                slave.erase(slave.rfind('/'));
+            }
+            stacked = true;
+            resolve_leaves(slave, info, depth + 1);
+        }
+        closedir(slaves);
+    }
+    if (stacked) {
+        return;
+    }
+
+    if (starts_with(name, "loop")) {
+        resolve_loop(dir, info, depth);
+        return;
+    }
+
+    info.disks.push_back(name);
+    if (read_sysfs_ulong(dir + "/queue/rotational", 0) == 1) {
+        info.rotational = true;
+    }
+    if (starts_with(name, "zram") || starts_with(name, "ram")) {
+        info.memory = true;
+    }
+    if (info.numa_node < 0) {
+        info.numa_node = find_numa_node(dir);
+    }
+}
+
+static StorageInfo resolve_storage(const char* path, dev_t dev) {
+    StorageInfo info;
+
+    struct statfs fs;
+    if (statfs(path, &fs) == 0) {
+        info.fs_type = fs_type_name(fs.f_type, info.memory, info.network);
+    }
+
+    string dir = block_dir_for(dev);
+    if (dir.empty() && !info.memory && !info.network) {
+        dir = block_dir_for(mount_source_device(dev));
+    }
+    if (dir.empty()) {
+        return info;
+    }
+
+    info.valid = true;
+    info.device = base_name(dir);
+
+    // Limits of the top device already account for the whole stack
+    info.discard_granularity = read_sysfs_ulong(dir + "/queue/discard_granularity", 0);
+    if (read_sysfs_ulong(dir + "/queue/discard_max_bytes", 0) == 0) {
+        info.discard_granularity = 0;
+    }
+    info.optimal_io_size = read_sysfs_ulong(dir + "/queue/optimal_io_size", 0);
+    info.logical_block_size = read_sysfs_ulong(dir + "/queue/logical_block_size", 512);
+
+    resolve_leaves(dir, info, 0);
+    return info;
+}
+
+const StorageInfo& storage_info(const char* path) {
+    static const StorageInfo unknown;
+
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0) {
+        return unknown;
+    }
+
+    {
+        lock_guard<mutex> guard(cache_lock);
+        auto it = cache.find(file_stat.st_dev);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    // Resolved outside the lock so slow sysfs walks don't serialize lookups
+    StorageInfo info = resolve_storage(path, file_stat.st_dev);
+
+    lock_guard<mutex> guard(cache_lock);
+    return cache.emplace(file_stat.st_dev, info).first->second;
+}
+#endif
+
+vector<string> backing_disks(const char* path) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0) {
+        return vector<string>();
+    }
+    const StorageInfo& info = storage_info(path);
+    if (!info.disks.empty()) {
+        return info.disks;
+    }
+    return vector<string>(1, "dev:" + to_string(static_cast<unsigned long>(file_stat.st_dev)));
+}
@@ -0,0 +1,32 @@
+// Parallel Digital Shredder - Storage Topology
+// Resolves a file's backing device through sysfs and caches it per st_dev
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+struct StorageInfo {
+    bool valid = false;               // backing block device resolved
+    std::string device;               // top-level device, e.g. "nvme0n1", "dm-0"
+    std::vector<std::string> disks;   // leaf disks under dm/md/loop stacks
+    std::string fs_type;              // "ext4", "btrfs", "tmpfs", ...
+    bool rotational = false;          // any leaf disk spins
+    bool memory = false;              // tmpfs/ramfs, zram, brd
+    bool network = false;             // NFS, SMB, Ceph, ...
+    unsigned long discard_granularity = 0; // bytes, 0 = no discard support
+    unsigned long optimal_io_size = 0;     // bytes, 0 = not reported
+    unsigned long logical_block_size = 512;
+    int numa_node = -1;
+};
+
+// Cached for the process lifetime; safe to call from several threads
+const StorageInfo& storage_info(const char* path);
+
+// What `path` competes with other writers for: its leaf disks (partitions
+// and dm/md/loop stacks resolved), or "dev:<st_dev>" when none were found
+// (tmpfs, network). Empty if `path` cannot be stat'ed.
+std::vector<std::string> backing_disks(const char* path);
+
+#endif // TOPOLOGY_H
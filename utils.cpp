@@ -5,10 +5,13 @@
 #include <fstream>
 #include <cstdio>
 #include <cstring>
-#include <random>
+#include <cstdlib>
 #include <algorithm>
 #include <cctype>
 #include <sys/stat.h>
+#include "keystream.h"
+#include "shredder.h"
+#include "topology.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -39,6 +42,33 @@ long get_file_size(FILE* file) {
     return size;
 }
 
+// Parse a byte count with an optional K/M/G suffix; returns -1 if malformed
+long parse_size(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) {
+        return -1;
+    }
+
+    switch (toupper(static_cast<unsigned char>(*end))) {
+        case '\0': break;
+        case 'K': value *= 1024.0; end++; break;
+        case 'M': value *= 1024.0 * 1024.0; end++; break;
+        case 'G': value *= 1024.0 * 1024.0 * 1024.0; end++; break;
+        default: return -1;
+    }
+
+    // Accept "4M", "4MB" and "4MiB"
+    if (*end == 'i' || *end == 'I') {
+        end++;
+    }
+    if (*end == 'B' || *end == 'b') {
+        end++;
+    }
+
+    return (*end == '\0') ? static_cast<long>(value) : -1;
+}
+
 bool validate_file(const char* path) {
     struct stat file_stat;
     if (stat(path, &file_stat) != 0) {
@@ -66,13 +96,27 @@ bool validate_file(const char* path) {
     return true;
 }
 
+// Job keystream under a fresh nonce, so no two calls repeat
 void fill_random_bytes(unsigned char* buffer, long size) {
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<> dis(0, 255);
+    uint64_t nonce;
+    system_random(&nonce, sizeof(nonce));
+    keystream_kernel()(buffer, size, 0, nonce);
+}
 
-    for (long i = 0; i < size; i++) {
-        buffer[i] = static_cast<unsigned char>(dis(gen));
+void display_progress_bar(int, int, int) {
+    // Simple percentage display without bulky bar
+    return;
+}
+
+void format_bytes(long bytes, char* buffer, size_t buffer_size) {
+    if (bytes < 1024) {
+        snprintf(buffer, buffer_size, "%ld B", bytes);
+    } else if (bytes < 1024 * 1024) {
+        snprintf(buffer, buffer_size, "%.2f KB", bytes / 1024.0);
+    } else if (bytes < 1024 * 1024 * 1024) {
+        snprintf(buffer, buffer_size, "%.2f MB", bytes / (1024.0 * 1024.0));
+    } else {
+        snprintf(buffer, buffer_size, "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
     }
 }
 
@@ -274,78 +318,16 @@ bool trim_file(const char* path, long file_size) {
 #else
 // Linux implementations for SSD detection and TRIM operations
 bool is_ssd(const char* path) {
-    // Get the device path from the file path
-    struct stat file_stat;
-    if (stat(path, &file_stat) != 0) {
-        cerr << "Warning: Could not stat file for SSD detection\n";
-        return false;
-    }
-
-    // Get the device name
-    char device_path[256];
-    FILE* mounts = fopen("/proc/mounts", "r");
-    if (!mounts) {
-        cerr << "Warning: Could not read /proc/mounts\n";
-        return false;
-    }
-
-    char line[1024];
-    char mount_device[256] = "";
-    char mount_point[256] = "";
-    char longest_match[256] = "";
-    int longest_length = 0;
-
-    // Find the mount point for this file
-    while (fgets(line, sizeof(line), mounts)) {
-        if (sscanf(line, "%255s %255s", mount_device, mount_point) == 2) {
-            int len = strlen(mount_point);
-            if (strncmp(path, mount_point, len) == 0 && len > longest_length) {
-                longest_length = len;
-                strncpy(longest_match, mount_device, sizeof(longest_match) - 1);
-                longest_match[sizeof(longest_match) - 1] = '\0';
-            }
+    // Resolved once per device through sysfs, including dm/md/loop stacks
+    const StorageInfo& info = storage_info(path);
+    if (!info.valid) {
+        if (!info.memory && !info.network) {
+            cerr << "Warning: Could not determine device for file\n";
         }
-    }
-    fclose(mounts);
-
-    if (longest_length == 0) {
-        cerr << "Warning: Could not determine device for file\n";
         return false;
     }
 
-    // Extract the base device name (e.g., sda from /dev/sda1)
-    char base_device[256];
-    const char* dev_name = strrchr(longest_match, '/');
-    if (!dev_name) {
-        dev_name = longest_match;
-    } else {
-        dev_name++;
-    }
-
-    // Remove partition numbers
-    int i = 0;
-    while (dev_name[i] && !isdigit(dev_name[i]) && i < 255) {
-        base_device[i] = dev_name[i];
-        i++;
-    }
-    base_device[i] = '\0';
-
-    // Check if rotational (0 = SSD, 1 = HDD)
-    snprintf(device_path, sizeof(device_path), "/sys/block/%s/queue/rotational", base_device);
-    FILE* rotational = fopen(device_path, "r");
-    if (!rotational) {
-        cerr << "Warning: Could not determine if device is SSD\n";
-        return false;
-    }
-
-    char value[8];
-    if (fgets(value, sizeof(value), rotational)) {
-        fclose(rotational);
-        return (value[0] == '0');
-    }
-
-    fclose(rotational);
-    return false;
+    return !info.rotational && !info.memory;
 }
 
 bool trim_file(const char* path, long file_size) {
@@ -396,18 +378,3 @@ bool trim_file(const char* path, long file_size) {
     return true; // Return true even if not supported
 }
 #endif
-
-// Delete the file and free disk space
-bool secure_delete_file(const char* path, bool is_ssd_device, long file_size) {
-    if (is_ssd_device) {
-        trim_file(path, file_size);
-    }
-
-    // Delete the file
-    if (remove(path) != 0) {
-        cerr << "Error: Failed to delete file: " << path << "\n";
-        return false;
-    }
-
-    return true;
-}
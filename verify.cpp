@@ -0,0 +1,355 @@
+// Parallel Digital Shredder - Readback Verification
+// Each kernel stops at the first difference; a unit that matches is read
+// once and compared once, with no expected copy beyond one small block
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <omp.h>
+#include "cpu.h"
+#include "engine.h"
+#include "histogram.h"
+#include "numa.h"
+#include "verify.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+#define O_DIRECT 0
+#define O_CLOEXEC 0
+
+static long pread(int fd, void* buffer, size_t count, long offset) {
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<unsigned long long>(offset) >> 32);
+
+    DWORD read = 0;
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    if (!ReadFile(handle, buffer, static_cast<DWORD>(count), &read, &overlapped)) {
+        errno = EIO;
+        return -1;
+    }
+    return read;
+}
+#endif
+
+// A whole number of periods for every period up to 4, and of 32- and
+// 64-byte vectors, so one block lines up with the data at every step
+static const long REPEAT_BLOCK = 192;
+static_assert(MAX_PATTERN_BYTES <= 4, "REPEAT_BLOCK must stay a multiple of every period");
+
+// Random data regenerated and compared per block; fits in L1
+static const long REGEN_BLOCK = 4096;
+
+// Mismatching units listed individually; the count covers the rest
+static const size_t MAX_MISMATCHES = 64;
+
+static void build_repeat_block(unsigned char* block, long offset, const PassPattern& pattern) {
+    for (long i = 0; i < REPEAT_BLOCK; i++) {
+        block[i] = pattern.bytes[(offset + i) % pattern.period];
+    }
+}
+
+// memcmp is already vectorised by the C library; only the position of
+// the difference needs a byte loop, and only once
+static long first_difference_scalar(const unsigned char* data, const unsigned char* expected, long length) {
+    if (memcmp(data, expected, length) == 0) {
+        return -1;
+    }
+    long i = 0;
+    while (data[i] == expected[i]) {
+        i++;
+    }
+    return i;
+}
+
+static long compare_repeat_scalar(const unsigned char* data, long length, long offset,
+                                  const PassPattern& pattern) {
+    unsigned char block[REPEAT_BLOCK];
+    build_repeat_block(block, offset, pattern);
+    for (long i = 0; i < length; i += REPEAT_BLOCK) {
+        long diff = first_difference_scalar(data + i, block, min(REPEAT_BLOCK, length - i));
+        if (diff >= 0) {
+            return i + diff;
+        }
+    }
+    return -1;
+}
+
+// Streaming mode: the expected bytes of a random pass are regenerated from
+// the keystream one block at a time, just ahead of the comparison
+template <long (*Difference)(const unsigned char*, const unsigned char*, long)>
+static long compare_random(const unsigned char* data, long length, long offset,
+                           const PassPattern& pattern) {
+    alignas(64) unsigned char expected[REGEN_BLOCK];
+    FillKernel fill = fill_kernel_for(FILL_RANDOM);
+    for (long i = 0; i < length; i += REGEN_BLOCK) {
+        long count = min(REGEN_BLOCK, length - i);
+        fill(expected, count, offset + i, pattern);
+        long diff = Difference(data + i, expected, count);
+        if (diff >= 0) {
+            return i + diff;
+        }
+    }
+    return -1;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("avx2")))
+static long first_difference_avx2(const unsigned char* data, const unsigned char* expected, long length) {
+    long i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i got = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i want = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(expected + i));
+        unsigned differ = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(got, want)));
+        if (differ) {
+            return i + __builtin_ctz(differ);
+        }
+    }
+    for (; i < length; i++) {
+        if (data[i] != expected[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Three 32-byte lanes cover 96 bytes, a whole number of periods
+__attribute__((target("avx2")))
+static long compare_repeat_avx2(const unsigned char* data, long length, long offset,
+                                const PassPattern& pattern) {
+    alignas(32) unsigned char block[REPEAT_BLOCK];
+    build_repeat_block(block, offset, pattern);
+    const __m256i lane0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i lane1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(block + 32));
+    const __m256i lane2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(block + 64));
+
+    long i = 0;
+    for (; i + 96 <= length; i += 96) {
+        const __m256i* in = reinterpret_cast<const __m256i*>(data + i);
+        __m256i equal = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(in), lane0),
+                             _mm256_cmpeq_epi8(_mm256_loadu_si256(in + 1), lane1)),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(in + 2), lane2));
+        if (static_cast<unsigned>(_mm256_movemask_epi8(equal)) != 0xFFFFFFFFu) {
+            return i + first_difference_avx2(data + i, block, 96);
+        }
+    }
+    long diff = first_difference_avx2(data + i, block, length - i);
+    return (diff < 0) ? -1 : i + diff;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static long first_difference_avx512(const unsigned char* data, const unsigned char* expected, long length) {
+    long i = 0;
+    for (; i + 64 <= length; i += 64) {
+        __m512i got = _mm512_loadu_si512(data + i);
+        __m512i want = _mm512_loadu_si512(expected + i);
+        __mmask64 differ = _mm512_cmpneq_epi8_mask(got, want);
+        if (differ) {
+            return i + __builtin_ctzll(differ);
+        }
+    }
+    if (i < length) {
+        // Masked loads never touch bytes past the end
+        __mmask64 valid = (~0ULL) >> (64 - (length - i));
+        __m512i got = _mm512_maskz_loadu_epi8(valid, data + i);
+        __m512i want = _mm512_maskz_loadu_epi8(valid, expected + i);
+        __mmask64 differ = _mm512_mask_cmpneq_epi8_mask(valid, got, want);
+        if (differ) {
+            return i + __builtin_ctzll(differ);
+        }
+    }
+    return -1;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static long compare_repeat_avx512(const unsigned char* data, long length, long offset,
+                                  const PassPattern& pattern) {
+    alignas(64) unsigned char block[REPEAT_BLOCK];
+    build_repeat_block(block, offset, pattern);
+    const __m512i lane0 = _mm512_load_si512(block);
+    const __m512i lane1 = _mm512_load_si512(block + 64);
+    const __m512i lane2 = _mm512_load_si512(block + 128);
+
+    long i = 0;
+    for (; i + REPEAT_BLOCK <= length; i += REPEAT_BLOCK) {
+        __mmask64 differ = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(data + i), lane0) |
+                           _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(data + i + 64), lane1) |
+                           _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(data + i + 128), lane2);
+        if (differ) {
+            return i + first_difference_avx512(data + i, block, REPEAT_BLOCK);
+        }
+    }
+    long diff = first_difference_avx512(data + i, block, length - i);
+    return (diff < 0) ? -1 : i + diff;
+}
+#endif
+
+// Indexed by instruction-set level, then FillKind. SSE2 adds nothing over
+// the C library's memcmp, which the scalar kernels already use.
+#define SCALAR_KERNELS \
+    { compare_repeat_scalar, compare_repeat_scalar, compare_random<first_difference_scalar> }
+
+static const CompareKernel KERNELS[ISA_COUNT][3] = {
+    SCALAR_KERNELS,
+    SCALAR_KERNELS,
+#ifdef HAVE_X86_KERNELS
+    { compare_repeat_avx2, compare_repeat_avx2, compare_random<first_difference_avx2> },
+    { compare_repeat_avx512, compare_repeat_avx512, compare_random<first_difference_avx512> }
+#else
+    SCALAR_KERNELS,
+    SCALAR_KERNELS
+#endif
+};
+
+#undef SCALAR_KERNELS
+
+CompareKernel compare_kernel_for(FillKind kind) {
+    return KERNELS[active_isa()][kind];
+}
+
+// Fill `length` bytes from `offset`, retrying interrupted and short reads.
+// Returns 0 or the errno of the failure.
+static int read_span(int fd, unsigned char* buffer, long offset, long length) {
+    long done = 0;
+    while (done < length) {
+        long count = pread(fd, buffer + done, length - done, offset + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            return errno;
+        }
+        if (count == 0) {
+            // The file shrank under us
+            return EIO;
+        }
+        done += count;
+    }
+    return 0;
+}
+
+bool verify_pass(ShredContext& ctx, const char* path, const PassPattern& pattern,
+                 VerifyResult& result) {
+    result = VerifyResult();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        result.read_error = errno;
+        result.read_error_offset = 0;
+        return false;
+    }
+#ifdef POSIX_FADV_DONTNEED
+    // The pass has been flushed, so its pages are clean and can be
+    // dropped; the reads below then come from the device
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+    // Same split as the writer: aligned spans through O_DIRECT, the
+    // unaligned end of the file through the buffered descriptor. Pages
+    // still mapped by ctx.map are not dropped above, so mapped targets are
+    // read through O_DIRECT too; without it their check is cache-only.
+    int direct_fd = -1;
+    long direct_end = 0;
+    long alignment = max(ctx.alignment, 4096L);
+    if (ctx.plan.direct_io || ctx.map) {
+        direct_fd = open(path, O_RDONLY | O_DIRECT | O_CLOEXEC);
+        if (direct_fd >= 0 && O_DIRECT != 0) {
+            direct_end = ctx.file_size - ctx.file_size % alignment;
+        } else if (direct_fd >= 0) {
+            close(direct_fd);
+            direct_fd = -1;
+        }
+    }
+    result.cache_only = ctx.map && direct_fd < 0;
+
+    CompareKernel compare = compare_kernel_for(pattern.kind);
+    const long unit_size = ctx.plan.unit_size;
+    const long total_units = (ctx.file_size + unit_size - 1) / unit_size;
+    long checked = 0;
+
+    #pragma omp parallel num_threads(max(ctx.plan.threads, 1)) reduction(+:checked)
+    {
+        int slot = omp_get_thread_num();
+        ThreadAffinity saved;
+        bool pinned = !ctx.worker_cpus.empty() &&
+                      pin_current_thread(ctx.worker_cpus[slot], &saved);
+        unsigned char* buffer = alloc_local_buffer(unit_size);
+
+        #pragma omp for schedule(dynamic)
+        for (long unit = 0; unit < total_units; unit++) {
+            long offset = unit * unit_size;
+            long length = min(unit_size, ctx.file_size - offset);
+            auto start = chrono::steady_clock::now();
+
+            int error = buffer ? 0 : ENOMEM;
+            long direct_length = 0;
+            if (direct_fd >= 0 && offset % alignment == 0 && offset < direct_end) {
+                direct_length = min(length, direct_end - offset);
+            }
+            if (!error && direct_length > 0) {
+                error = read_span(direct_fd, buffer, offset, direct_length);
+            }
+            if (!error && direct_length < length) {
+                error = read_span(fd, buffer + direct_length, offset + direct_length,
+                                  length - direct_length);
+            }
+            long diff = error ? -1 : compare(buffer, length, offset, pattern);
+
+            int stats_slot = ctx.worker_base + slot;
+            if (ctx.stats && stats_slot < ctx.stats->worker_slots()) {
+                ctx.stats->worker(stats_slot).stages[STAGE_VERIFY].record(
+                    chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+            }
+            if (!error) {
+                checked += length;
+            }
+
+            if (error || diff >= 0) {
+                #pragma omp critical(verify_result)
+                {
+                    if (error && (result.read_error == 0 || offset < result.read_error_offset)) {
+                        result.read_error = error;
+                        result.read_error_offset = offset;
+                    }
+                    if (diff >= 0) {
+                        result.mismatched_units++;
+                        result.mismatches.push_back(offset + diff);
+                    }
+                }
+            }
+        }
+
+        free_local_buffer(buffer, unit_size);
+        if (pinned) {
+            restore_thread_affinity(saved);
+        }
+    }
+
+    if (direct_fd >= 0) {
+        close(direct_fd);
+    }
+    close(fd);
+
+    result.bytes_checked = checked;
+    sort(result.mismatches.begin(), result.mismatches.end());
+    if (result.mismatches.size() > MAX_MISMATCHES) {
+        result.mismatches.resize(MAX_MISMATCHES);
+    }
+    return result.read_error == 0 && result.mismatched_units == 0;
+}
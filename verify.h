@@ -0,0 +1,39 @@
+// Parallel Digital Shredder - Readback Verification
+// Compare kernels for every pattern kind and the parallel readback pass
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <vector>
+#include "pattern.h"
+
+struct ShredContext;
+
+// Index of the first byte of `data` that differs from what `pattern` puts
+// at file offset `offset`, or -1 if all `length` bytes match. Stops at the
+// first difference. Random passes are regenerated from the pattern's nonce
+// a block at a time, so no expected copy of the unit is ever held.
+typedef long (*CompareKernel)(const unsigned char* data, long length, long offset,
+                              const PassPattern& pattern);
+
+// Kernel for the active instruction-set level (see cpu.h)
+CompareKernel compare_kernel_for(FillKind kind);
+
+struct VerifyResult {
+    long bytes_checked = 0;
+    long mismatched_units = 0;
+    std::vector<long> mismatches;   // first bad offset per unit, ascending, capped
+    int read_error = 0;             // errno of the first failed read, 0 = none
+    long read_error_offset = -1;
+    bool cache_only = false;        // mapped file, no O_DIRECT: the page cache was compared
+};
+
+// Read the whole file back after a pass and compare it with `pattern`.
+// The page cache is dropped first where possible, so buffered reads come
+// from the device; direct I/O and mapped targets are read with O_DIRECT
+// (the partial block at the end of the file always goes through the
+// cache). Returns true if every byte matched.
+bool verify_pass(ShredContext& ctx, const char* path, const PassPattern& pattern,
+                 VerifyResult& result);
+
+#endif // VERIFY_H